@@ -29,82 +29,81 @@
 #define ARGSTREAM_H
 
 #include <string>
-#include <list>
 #include <deque>
-#include <map>
+#include <vector>
+#include <algorithm>
 #include <stdexcept>
 #include <sstream>
 #include <iostream>
 #include <locale>
-#include <codecvt>
 #include <type_traits>
+#include <limits>
 #include <cassert>
 #include <memory>
+#include <atomic>
+#include <cstring>
+#include <cstdio>
+#ifdef _WIN32
+#include <io.h>
+#include <cstdlib>
+#define ARGSTREAM_ENVIRON _environ
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if defined(__APPLE__)
+#include <crt_externs.h>
+#define ARGSTREAM_ENVIRON (*_NSGetEnviron())
+#else
+#define ARGSTREAM_ENVIRON environ // Declared by <unistd.h>
+#endif
+#endif
+// Response and configuration files are mapped, define ARGSTREAM_NO_MMAP to read them
+#if !defined(_WIN32) && !defined(ARGSTREAM_NO_MMAP)
+#include <sys/mman.h>
+#endif
+// Parallel batch::parse(first, last, threads), define ARGSTREAM_THREADS to enable
+#ifdef ARGSTREAM_THREADS
+#include <thread>
+#include <mutex>
+#endif
+#ifdef ARGSTREAM_INSTRUMENT
+#include <chrono>
+#endif
 
-namespace argstream
-{
-	//--------------------------------------------------------------------------
-
-	typedef enum
-    {
-		PARSED_OK = 0,
-		PARSED_ERR_HELP_REQUESTED,
-		PARSED_ERR_UNUSED_PARAMETER,
-		PARSED_ERR_OTHER
-	} RESULT_OF_PARSE;
-
-	/**
-       Main class to store the argument string.
-	*/
-	template<typename CHARTYPE>
-    class argstream;
-
-	/**
-       Get the help description.
-	*/
-	template<typename CHARTYPE, typename T>
-    struct description_policy;
-
-	/**
-       The option holder which store the specified option.
-	*/
-	template <typename CHARTYPE>
-    class OptionHolder;
-
-	/**
-       The value holder which stores the value of the speicified argument.
-	*/
-	template<typename CHARTYPE, typename T>
-    class ValueHolder;
-
-	/*
-	template<typename CHARTYPE, typename T, typename O>
-    class ValuesHolder;
-	*/
-
-	/**
-       Convert UTF-8 string to UTF-16 and vice versa.
-	*/
-	template<typename CHARTYPE>
-    struct TSTR;
+// SIMD scanning of command line strings, define ARGSTREAM_NO_SIMD to disable
+#if !defined(ARGSTREAM_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define ARGSTREAM_SIMD_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#define ARGSTREAM_SIMD_AVX2
+#define ARGSTREAM_TARGET_AVX2
+#include <immintrin.h>
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ARGSTREAM_SIMD_AVX2
+#define ARGSTREAM_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#endif
 
-	/**
-       Template string stream
-	*/
-	template<typename CHARTYPE>
-    struct TSTRSTREAM;
+// Compiled library mode, define ARGSTREAM_EXTERN_TEMPLATE to link with
+// lib/argstream.cpp: the larger members of argstream<char> and
+// argstream<wchar_t> are then compiled once there instead of in every
+// translation unit, see the end of this file.
+#ifdef ARGSTREAM_EXTERN_TEMPLATE
+#define ARGSTREAM_INLINE
+#else
+#define ARGSTREAM_INLINE inline
+#endif
 
-	/**
-       Store the copyright information.
-	*/
-	template <typename CHARTYPE>
-    class CopyrightHolder;
+#include "argstream_fwd.h"
 
-	/**
-       Store the command usage examples.
-	*/
-	template <typename CHARTYPE>
-    class ExampleHolder;
+namespace argstream
+{
+	//--------------------------------------------------------------------------
 
 	/**
        Parse the command line and store the specified parameter value.
@@ -116,14 +115,45 @@ namespace argstream
               const CHARTYPE* l,
               T& b,
               const CHARTYPE* desc,
-              bool mandatory = true
+              bool mandatory = true,
+              const CHARTYPE* env = NULL
              );
 
-	/* Disable it temporarily
-	template<typename CHARTYPE, typename T, typename O>
+	/**
+		Generate the positional values.
+
+		@param o Output iterator the values are written to, for instance
+		         std::back_inserter(container).
+		@param desc Description of the values in argstream::usage().
+		@param len Number of values expected, -1 to take all the remaining ones.
+
+		@return The values holder, T is the type of the values:
+		        values<int>(std::back_inserter(l), "desc").
+	*/
+	template<typename T, typename CHARTYPE, typename O>
 	inline ValuesHolder<CHARTYPE, T, O>
 	values(const O& o, const CHARTYPE* desc, int len=-1);
+
+	/**
+		Generate the positional values appended to a vector, which is grown
+		once for all of them.
+	*/
+	template<typename T, typename CHARTYPE, typename A>
+	inline ValuesHolder<CHARTYPE, T, std::vector<T, A>*>
+	values(std::vector<T, A>& v, const CHARTYPE* desc, int len=-1);
+
+	/**
+		Generate the positional values, completed by the records of in once
+		the values of the command line are taken: find . -print0 | tool -0.
+		The records are parsed one by one as they are read.
 	*/
+	template<typename T, typename CHARTYPE, typename O>
+	inline ValuesHolder<CHARTYPE, T, O>
+	values(NulReader<CHARTYPE>& in, const O& o, const CHARTYPE* desc, int len=-1);
+
+	template<typename T, typename CHARTYPE, typename A>
+	inline ValuesHolder<CHARTYPE, T, std::vector<T, A>*>
+	values(NulReader<CHARTYPE>& in, std::vector<T, A>& v, const CHARTYPE* desc, int len=-1);
 
 	/**
 		Generate the option.
@@ -132,6 +162,9 @@ namespace argstream
 		@param l Long parameter name.
 		@param b Whether the parameter appears or not.
 		@param desc The description of the parameter.
+		@param env Environment variable read when the option is not on the
+		           command line, NULL if none. The option is set unless the
+		           variable is empty, 0, false, no or off.
 
 		@return The option holder.
 	*/
@@ -141,7 +174,8 @@ namespace argstream
            CHARTYPE s,
            const CHARTYPE* l,
            bool& b,
-           const CHARTYPE* desc
+           const CHARTYPE* desc,
+           const CHARTYPE* env = NULL
           );
 
 	/**
@@ -190,18 +224,17 @@ namespace argstream
 	operator >>(argstream<CHARTYPE>& s, ValueHolder<CHARTYPE, T> const& v);
 
 	/**
-		Parse the "option - value1 value2 value3" parameters.
+		Parse the positional "value1 value2 value3" parameters, the values
+		which are not consumed by an option, in the order of the command line.
 
 		@param s Reference to the argstream object which is going to be parsed.
 		@param v Reference to the values holder which stores the values.
 
 		@return Reference to the parsed argstream object.
 	*/
-	/*
 	template<typename CHARTYPE, typename T, typename O>
 	inline argstream<CHARTYPE>&
 	operator >>(argstream<CHARTYPE>& s, ValuesHolder<CHARTYPE, T, O> const& v);
-	*/
 
 	/**
 		Parse the "option" parameters.
@@ -238,810 +271,5442 @@ namespace argstream
 	template<typename CHARTYPE>
 	inline argstream<CHARTYPE>&
     operator >>(argstream<CHARTYPE>& s, CopyrightHolder<CHARTYPE> const& c);
+
+	/**
+		Declare a parameter in a schema.
+
+		@param s Reference to the schema.
+		@param v Reference to the value holder which stores the value.
+
+		@return Reference to the schema.
+	*/
+	template<typename CHARTYPE, typename T>
+	inline schema<CHARTYPE>&
+	operator >>(schema<CHARTYPE>& s, ValueHolder<CHARTYPE, T> const& v);
+
+	/**
+		Declare an option in a schema.
+
+		@param s Reference to the schema.
+		@param v Reference to the option holder which stores the existence of the option.
+
+		@return Reference to the schema.
+	*/
+	template<typename CHARTYPE>
+	inline schema<CHARTYPE>&
+	operator >>(schema<CHARTYPE>& s, OptionHolder<CHARTYPE> const& v);
 	//--------------------------------------------------------------------------
 
 	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	// Interface of TSTR<CHARTYPE>
+	// Interface and implementation of memory_resource
 	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	template<typename CHARTYPE>
-	struct TSTR
+
+	/**
+		Source of the memory used by an argstream, modelled after
+		std::pmr::memory_resource which is not available in C++11.
+	*/
+	class memory_resource
 	{
-		typedef std::basic_string<CHARTYPE, std::char_traits<CHARTYPE>, std::allocator<CHARTYPE>> type;
+	public:
+		virtual ~memory_resource() {}
+		inline void* allocate(size_t bytes, size_t alignment)
+		{
+			return do_allocate(bytes, alignment);
+		}
+		inline void deallocate(void* p, size_t bytes, size_t alignment)
+		{
+			do_deallocate(p, bytes, alignment);
+		}
+		inline bool is_equal(const memory_resource& other) const
+		{
+			return do_is_equal(other);
+		}
+	protected:
+		virtual void* do_allocate(size_t bytes, size_t alignment) = 0;
+		virtual void do_deallocate(void* p, size_t bytes, size_t alignment) = 0;
+		virtual bool do_is_equal(const memory_resource& other) const = 0;
+	};
 
-		static inline typename TSTR::type ToString(const char* utf8_str);
-		static inline typename TSTR::type ToString(const wchar_t* wstr);
-		static inline typename TSTR::type ToString(char c);
-		static inline typename TSTR::type ToString(wchar_t wc);
+	/**
+		Memory resource using the global operator new and delete.
+	*/
+	class new_delete_resource_type : public memory_resource
+	{
+	protected:
+		virtual void* do_allocate(size_t bytes, size_t)
+		{
+			return ::operator new(bytes);
+		}
+		virtual void do_deallocate(void* p, size_t, size_t)
+		{
+			::operator delete(p);
+		}
+		virtual bool do_is_equal(const memory_resource& other) const
+		{
+			return this == &other;
+		}
 	};
 
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	// Implementation of TSTR<CHARTYPE>
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	template<>
-	std::wstring TSTR<wchar_t>::ToString(const char* utf8_str)
+	inline memory_resource* new_delete_resource()
 	{
-		std::wstring_convert<std::codecvt_utf8<wchar_t>> conv;
-		return conv.from_bytes(utf8_str);
+		static new_delete_resource_type resource;
+		return &resource;
 	}
 
-	template<>
-	std::wstring TSTR<wchar_t>::ToString(const wchar_t* wstr)
+	/**
+		Memory resource which only releases its memory when it is destroyed
+		or release() is called. Allocations are carved out of chunks taken
+		from an upstream resource, and deallocations do nothing, so that a
+		whole parse can be thrown away in one shot.
+	*/
+	class monotonic_buffer_resource : public memory_resource
 	{
-		return std::wstring(wstr);
-	}
+	public:
+		inline explicit monotonic_buffer_resource(
+			size_t initialSize = 1024,
+			memory_resource* upstream = new_delete_resource())
+			: upstream_(upstream), chunks_(NULL), current_(NULL), left_(0),
+			nextSize_(initialSize < 64 ? 64 : initialSize),
+			initial_(NULL), initialSize_(0), initialNextSize_(nextSize_)
+		{
+		}
 
-	template<>
-	std::wstring TSTR<wchar_t>::ToString(char c)
+		/**
+			Allocate first from a buffer provided by the caller, for instance
+			on the stack.
+		*/
+		inline monotonic_buffer_resource(
+			void* buffer,
+			size_t size,
+			memory_resource* upstream = new_delete_resource())
+			: upstream_(upstream), chunks_(NULL), current_(static_cast<char*>(buffer)), left_(size),
+			nextSize_(size < 64 ? 128 : size * 2),
+			initial_(current_), initialSize_(size), initialNextSize_(nextSize_)
+		{
+		}
+
+		virtual ~monotonic_buffer_resource()
+		{
+			release();
+		}
+
+		/**
+			Give back to the upstream resource all the memory allocated. The
+			next allocations start again from the buffer of the caller, if
+			any, as std::pmr::monotonic_buffer_resource does.
+		*/
+		inline void release()
+		{
+			while (chunks_ != NULL)
+			{
+				chunk* next = chunks_->next;
+				upstream_->deallocate(chunks_, chunks_->size, sizeof(void*) * 2);
+				chunks_ = next;
+			}
+			current_ = initial_;
+			left_ = initialSize_;
+			nextSize_ = initialNextSize_;
+		}
+	protected:
+		virtual void* do_allocate(size_t bytes, size_t alignment)
+		{
+			size_t padding = (alignment - reinterpret_cast<size_t>(current_) % alignment) % alignment;
+			if (current_ == NULL || padding + bytes > left_)
+			{
+				size_t size = sizeof(chunk) + bytes + alignment;
+				if (size < nextSize_) size = nextSize_;
+				chunk* c = static_cast<chunk*>(upstream_->allocate(size, sizeof(void*) * 2));
+				c->next = chunks_;
+				c->size = size;
+				chunks_ = c;
+				current_ = reinterpret_cast<char*>(c + 1);
+				left_ = size - sizeof(chunk);
+				nextSize_ = size * 2;
+				padding = (alignment - reinterpret_cast<size_t>(current_) % alignment) % alignment;
+			}
+			void* p = current_ + padding;
+			current_ += padding + bytes;
+			left_ -= padding + bytes;
+			return p;
+		}
+		virtual void do_deallocate(void*, size_t, size_t)
+		{
+		}
+		virtual bool do_is_equal(const memory_resource& other) const
+		{
+			return this == &other;
+		}
+	private:
+		struct chunk
+		{
+			chunk* next;
+			size_t size;
+		};
+
+		monotonic_buffer_resource(const monotonic_buffer_resource&) = delete;
+		monotonic_buffer_resource& operator=(const monotonic_buffer_resource&) = delete;
+
+		memory_resource* upstream_;
+		chunk* chunks_;
+		char* current_;
+		size_t left_;
+		size_t nextSize_;
+		char* initial_; // Buffer given to the constructor, NULL if none
+		size_t initialSize_;
+		size_t initialNextSize_;
+	};
+
+	/**
+		Standard allocator which takes its memory from a memory_resource,
+		like std::pmr::polymorphic_allocator.
+	*/
+	template<typename T>
+	class resource_allocator
+	{
+	public:
+		typedef T value_type;
+
+		inline resource_allocator() : resource_(new_delete_resource()) {}
+		inline resource_allocator(memory_resource* r) : resource_(r) {}
+		template<typename U>
+		inline resource_allocator(const resource_allocator<U>& other) : resource_(other.resource()) {}
+
+		inline T* allocate(size_t n)
+		{
+			return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+		}
+		inline void deallocate(T* p, size_t n)
+		{
+			resource_->deallocate(p, n * sizeof(T), alignof(T));
+		}
+		inline memory_resource* resource() const
+		{
+			return resource_;
+		}
+	private:
+		memory_resource* resource_;
+	};
+
+	template<typename T, typename U>
+	inline bool operator==(const resource_allocator<T>& l, const resource_allocator<U>& r)
 	{
-		std::wstring_convert<std::codecvt_utf8<wchar_t>> conv;
-		return conv.from_bytes(c);
+		return l.resource() == r.resource() || l.resource()->is_equal(*r.resource());
 	}
 
-	template<>
-	std::wstring TSTR<wchar_t>::ToString(wchar_t wc)
+	template<typename T, typename U>
+	inline bool operator!=(const resource_allocator<T>& l, const resource_allocator<U>& r)
 	{
-		wchar_t buf[] = {wc, 0};
-		return std::wstring(buf);
+		return !(l == r);
 	}
 
-	template<>
-	std::string TSTR<char>::ToString(const char* utf8_str)
+	/**
+		Memory resource which counts the allocations made through it before
+		passing them to an upstream resource, to see what a parse costs.
+	*/
+	class counting_resource : public memory_resource
 	{
-		return std::string(utf8_str);
+	public:
+		inline explicit counting_resource(memory_resource* upstream = new_delete_resource())
+			: upstream_(upstream), allocations_(0), deallocations_(0), bytes_(0)
+		{
+		}
+
+		inline size_t allocations() const { return allocations_; }
+		inline size_t deallocations() const { return deallocations_; }
+		inline size_t bytes() const { return bytes_; }
+
+		inline void reset()
+		{
+			allocations_ = 0;
+			deallocations_ = 0;
+			bytes_ = 0;
+		}
+	protected:
+		virtual void* do_allocate(size_t bytes, size_t alignment)
+		{
+			++allocations_;
+			bytes_ += bytes;
+			return upstream_->allocate(bytes, alignment);
+		}
+		virtual void do_deallocate(void* p, size_t bytes, size_t alignment)
+		{
+			++deallocations_;
+			upstream_->deallocate(p, bytes, alignment);
+		}
+		virtual bool do_is_equal(const memory_resource& other) const
+		{
+			return this == &other;
+		}
+	private:
+		memory_resource* upstream_;
+		size_t allocations_;
+		size_t deallocations_;
+		size_t bytes_;
+	};
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface and implementation of SIMD_LEVEL
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+	typedef enum
+	{
+		SIMD_SCALAR = 0,
+		SIMD_SSE2,
+		SIMD_AVX2
+	} SIMD_LEVEL;
+
+	/**
+		Best instruction set supported by both the build and the processor,
+		detected at run time.
+	*/
+	inline SIMD_LEVEL simd_supported()
+	{
+#if defined(ARGSTREAM_SIMD_AVX2) && defined(_MSC_VER)
+		static const SIMD_LEVEL level = []() {
+			int r[4];
+			__cpuid(r, 0);
+			if (r[0] < 7) return SIMD_SSE2;
+			__cpuid(r, 1);
+			// AVX and OSXSAVE, then the OS saves the YMM registers
+			if ((r[2] & (1 << 27)) == 0 || (r[2] & (1 << 28)) == 0) return SIMD_SSE2;
+			if ((_xgetbv(0) & 6) != 6) return SIMD_SSE2;
+			__cpuidex(r, 7, 0);
+			return (r[1] & (1 << 5)) != 0 ? SIMD_AVX2 : SIMD_SSE2;
+		}();
+		return level;
+#elif defined(ARGSTREAM_SIMD_AVX2)
+		static const SIMD_LEVEL level = __builtin_cpu_supports("avx2") ? SIMD_AVX2 : SIMD_SSE2;
+		return level;
+#elif defined(ARGSTREAM_SIMD_SSE2)
+		return SIMD_SSE2;
+#else
+		return SIMD_SCALAR;
+#endif
 	}
 
-	template<>
-	std::string TSTR<char>::ToString(const wchar_t* wstr)
+	inline std::atomic<int>& simd_level_storage()
 	{
-		std::wstring_convert<std::codecvt_utf8<wchar_t>> conv;
-		return conv.to_bytes(wstr);
+		static std::atomic<int> level(simd_supported());
+		return level;
 	}
 
-	template<>
-	std::string TSTR<char>::ToString(char c)
+	/**
+		Instruction set used to scan command line strings.
+	*/
+	inline SIMD_LEVEL simd_level()
 	{
-		char buf[] = {c, 0};
-		return std::string(buf);
+		return static_cast<SIMD_LEVEL>(simd_level_storage().load(std::memory_order_relaxed));
 	}
 
-	template<>
-	std::string TSTR<char>::ToString(wchar_t wc)
+	/**
+		Choose the instruction set used to scan command line strings, for
+		instance to compare the scalar and vector code. Levels above
+		simd_supported() are lowered to it.
+	*/
+	inline void set_simd_level(SIMD_LEVEL level)
 	{
-		std::wstring_convert<std::codecvt_utf8<wchar_t>> conv;
-		return conv.to_bytes(wc);
+		simd_level_storage().store(std::min(level, simd_supported()), std::memory_order_relaxed);
 	}
 
+#ifdef ARGSTREAM_SIMD_SSE2
 	/**
-		@todo Expand this struct to hold file string and etc.
+		Index of the lowest bit set in mask, which is not 0.
 	*/
-	template<typename CHARTYPE>
-	struct TSTRSTREAM
+	inline unsigned firstBit(unsigned mask)
 	{
-		typedef std::basic_istringstream<CHARTYPE, std::char_traits<CHARTYPE>,std::allocator<CHARTYPE>> I;
-		typedef std::basic_ostringstream<CHARTYPE, std::char_traits<CHARTYPE>, std::allocator<CHARTYPE>> O;
-		typedef std::basic_ostream<CHARTYPE, std::char_traits<CHARTYPE> > COUT;
-	};
+#ifdef _MSC_VER
+		unsigned long i;
+		_BitScanForward(&i, mask);
+		return static_cast<unsigned>(i);
+#else
+		return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+	}
+#endif
 
 	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	// Interface of ValueHolder<CHARTYPE, T>
+	// Interface and implementation of Utf8
 	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	template<typename CHARTYPE, typename T>
-	class ValueHolder
+
+	typedef enum
 	{
-	public:
-		ValueHolder(CHARTYPE s,
-			const CHARTYPE* l,
-			T& b,
-			const CHARTYPE* desc,
-			bool mandatory);
-		ValueHolder(const CHARTYPE* l,
-			T& b,
-			const CHARTYPE* desc,
-			bool mandatory);
-		ValueHolder(CHARTYPE s,
-			T& b,
-			const CHARTYPE* desc,
-			bool mandatory);
+		UTF_REPLACE = 0, // Replace each invalid sequence by U+FFFD and go on
+		UTF_STRICT       // Stop at the first invalid sequence
+	} UTF_ERRORS;
 
-		template<typename C, typename T2>
-		friend argstream<C>& operator>>(argstream<C>& s, ValueHolder<C, T2> const& v);
+	struct transcode_result
+	{
+		size_t read;    // Input characters consumed, up to the error with UTF_STRICT
+		size_t written; // Output characters written
+		size_t invalid; // Invalid sequences met
+	};
 
-		friend struct description_policy<CHARTYPE, T>;
+	/**
+		Conversions between UTF-8 and wchar_t strings, UTF-16 where wchar_t
+		has 16 bits and UTF-32 elsewhere. Runs of ASCII characters are
+		converted 16 at a time with SSE2.
 
-		typename TSTR<CHARTYPE>::type name() const;
-		typename TSTR<CHARTYPE>::type description() const;
-	private:
-		typename TSTR<CHARTYPE>::type shortName_;
-		typename TSTR<CHARTYPE>::type longName_;
-		T* value_;
-		T initialValue_;
-		typename TSTR<CHARTYPE>::type description_;
-		bool mandatory_;
-	};
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	// Implementation of ValueHodler<CHARTYPE, T>
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	template<typename CHARTYPE, typename T>
-	ValueHolder<CHARTYPE, T>::ValueHolder(
-		CHARTYPE s,
-		const CHARTYPE* l,
-		T& v,
-		const CHARTYPE* desc,
+		The conversions write into a buffer provided by the caller, which
+		must hold maxDecodedSize() or maxEncodedSize() characters. Invalid
+		sequences are the ill-formed UTF-8 sequences (overlong forms,
+		surrogates, code points above U+10FFFF, truncated sequences), the
+		unpaired surrogates and the wchar_t above U+10FFFF. Each maximal
+		invalid subpart gives one U+FFFD with UTF_REPLACE.
+	*/
+	class Utf8
+	{
+	public:
+		static inline size_t maxDecodedSize(size_t n)
+		{
+			return n;
+		}
+
+		static inline size_t maxEncodedSize(size_t n)
+		{
+			return n * (sizeof(wchar_t) == 2 ? 3 : 4);
+		}
+
+		/**
+			Convert n UTF-8 characters from s into out.
+		*/
+		static inline transcode_result decode(
+			const char* s, size_t n, wchar_t* out, UTF_ERRORS errors = UTF_REPLACE)
+		{
+			const unsigned char* p = reinterpret_cast<const unsigned char*>(s);
+			transcode_result r = { 0, 0, 0 };
+			size_t i = 0;
+			wchar_t* o = out;
+#ifdef ARGSTREAM_SIMD_SSE2
+			bool vector = simd_level() >= SIMD_SSE2;
+#endif
+			while (i < n)
+			{
+				size_t blockEnd = n;
+#ifdef ARGSTREAM_SIMD_SSE2
+				if (vector && n - i >= 16)
+				{
+					// Widen the whole block but keep only its ASCII prefix, out
+					// has room since a character never takes more than a byte.
+					__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+					unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(x));
+					size_t ascii = mask == 0 ? 16 : firstBit(mask);
+					storeWidened(x, o);
+					i += ascii;
+					o += ascii;
+					if (mask == 0)
+					{
+						continue;
+					}
+					// Then decode the sequence which ended the prefix
+					blockEnd = i + 1;
+				}
+#endif
+				while (i < n && i < blockEnd)
+				{
+					unsigned c = p[i];
+					if (c < 0x80)
+					{
+						*o++ = static_cast<wchar_t>(c);
+						++i;
+						continue;
+					}
+					size_t length = 0;
+					unsigned lower = 0x80;
+					unsigned upper = 0xBF;
+					unsigned long cp = 0;
+					if (c >= 0xC2 && c <= 0xDF) { length = 2; cp = c & 0x1F; }
+					else if (c >= 0xE0 && c <= 0xEF)
+					{
+						length = 3;
+						cp = c & 0x0F;
+						if (c == 0xE0) lower = 0xA0;
+						if (c == 0xED) upper = 0x9F;
+					}
+					else if (c >= 0xF0 && c <= 0xF4)
+					{
+						length = 4;
+						cp = c & 0x07;
+						if (c == 0xF0) lower = 0x90;
+						if (c == 0xF4) upper = 0x8F;
+					}
+					size_t j = i + 1;
+					if (length != 0)
+					{
+						for (; j < i + length && j < n; ++j)
+						{
+							unsigned d = p[j];
+							if (d < lower || d > upper)
+							{
+								break;
+							}
+							cp = (cp << 6) | (d & 0x3F);
+							lower = 0x80;
+							upper = 0xBF;
+						}
+					}
+					if (length == 0 || j != i + length)
+					{
+						++r.invalid;
+						if (errors == UTF_STRICT)
+						{
+							r.read = i;
+							r.written = o - out;
+							return r;
+						}
+						*o++ = static_cast<wchar_t>(0xFFFD);
+						i = j;
+						continue;
+					}
+					o = putCodePoint(cp, o);
+					i = j;
+				}
+			}
+			r.read = i;
+			r.written = o - out;
+			return r;
+		}
+
+		/**
+			Convert n wchar_t from s into out as UTF-8.
+		*/
+		static inline transcode_result encode(
+			const wchar_t* s, size_t n, char* out, UTF_ERRORS errors = UTF_REPLACE)
+		{
+			transcode_result r = { 0, 0, 0 };
+			size_t i = 0;
+			char* o = out;
+#ifdef ARGSTREAM_SIMD_SSE2
+			bool vector = simd_level() >= SIMD_SSE2;
+			size_t blockEnd = 0;
+#endif
+			while (i < n)
+			{
+#ifdef ARGSTREAM_SIMD_SSE2
+				if (vector && i >= blockEnd && n - i >= 16)
+				{
+					if (storeNarrowed(s + i, o))
+					{
+						i += 16;
+						o += 16;
+						continue;
+					}
+					// Go through the rest of the block one by one
+					blockEnd = i + 16;
+				}
+#endif
+				unsigned long cp = static_cast<unsigned long>(static_cast<typename std::make_unsigned<wchar_t>::type>(s[i]));
+				size_t length = 1;
+				bool valid = cp <= 0x10FFFF;
+				if (cp >= 0xD800 && cp <= 0xDFFF)
+				{
+					valid = false;
+					if (sizeof(wchar_t) == 2 && cp <= 0xDBFF && i + 1 < n)
+					{
+						unsigned long low = static_cast<unsigned long>(static_cast<typename std::make_unsigned<wchar_t>::type>(s[i + 1]));
+						if (low >= 0xDC00 && low <= 0xDFFF)
+						{
+							cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+							length = 2;
+							valid = true;
+						}
+					}
+				}
+				if (!valid)
+				{
+					++r.invalid;
+					if (errors == UTF_STRICT)
+					{
+						r.read = i;
+						r.written = o - out;
+						return r;
+					}
+					cp = 0xFFFD;
+				}
+				if (cp < 0x80)
+				{
+					*o++ = static_cast<char>(cp);
+				}
+				else if (cp < 0x800)
+				{
+					*o++ = static_cast<char>(0xC0 | (cp >> 6));
+					*o++ = static_cast<char>(0x80 | (cp & 0x3F));
+				}
+				else if (cp < 0x10000)
+				{
+					*o++ = static_cast<char>(0xE0 | (cp >> 12));
+					*o++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+					*o++ = static_cast<char>(0x80 | (cp & 0x3F));
+				}
+				else
+				{
+					*o++ = static_cast<char>(0xF0 | (cp >> 18));
+					*o++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+					*o++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+					*o++ = static_cast<char>(0x80 | (cp & 0x3F));
+				}
+				i += length;
+			}
+			r.read = i;
+			r.written = o - out;
+			return r;
+		}
+
+		/**
+			Convert into a string, reusing its memory.
+		*/
+		template<typename ALLOC>
+		static inline transcode_result decode(
+			const char* s, size_t n,
+			std::basic_string<wchar_t, std::char_traits<wchar_t>, ALLOC>& out,
+			UTF_ERRORS errors = UTF_REPLACE)
+		{
+			out.resize(maxDecodedSize(n));
+			transcode_result r = decode(s, n, n != 0 ? &out[0] : NULL, errors);
+			out.resize(r.written);
+			return r;
+		}
+
+		template<typename ALLOC>
+		static inline transcode_result encode(
+			const wchar_t* s, size_t n,
+			std::basic_string<char, std::char_traits<char>, ALLOC>& out,
+			UTF_ERRORS errors = UTF_REPLACE)
+		{
+			out.resize(maxEncodedSize(n));
+			transcode_result r = encode(s, n, n != 0 ? &out[0] : NULL, errors);
+			out.resize(r.written);
+			return r;
+		}
+	private:
+		static inline wchar_t* putCodePoint(unsigned long cp, wchar_t* o)
+		{
+			if (sizeof(wchar_t) == 2 && cp >= 0x10000)
+			{
+				cp -= 0x10000;
+				*o++ = static_cast<wchar_t>(0xD800 + (cp >> 10));
+				*o++ = static_cast<wchar_t>(0xDC00 + (cp & 0x3FF));
+			}
+			else
+			{
+				*o++ = static_cast<wchar_t>(cp);
+			}
+			return o;
+		}
+#ifdef ARGSTREAM_SIMD_SSE2
+		/**
+			Store 16 ASCII characters as wchar_t.
+		*/
+		static inline void storeWidened(__m128i x, wchar_t* o)
+		{
+			__m128i zero = _mm_setzero_si128();
+			__m128i lo = _mm_unpacklo_epi8(x, zero);
+			__m128i hi = _mm_unpackhi_epi8(x, zero);
+			__m128i* v = reinterpret_cast<__m128i*>(o);
+			if (sizeof(wchar_t) == 2)
+			{
+				_mm_storeu_si128(v, lo);
+				_mm_storeu_si128(v + 1, hi);
+			}
+			else
+			{
+				_mm_storeu_si128(v, _mm_unpacklo_epi16(lo, zero));
+				_mm_storeu_si128(v + 1, _mm_unpackhi_epi16(lo, zero));
+				_mm_storeu_si128(v + 2, _mm_unpacklo_epi16(hi, zero));
+				_mm_storeu_si128(v + 3, _mm_unpackhi_epi16(hi, zero));
+			}
+		}
+
+		/**
+			Store 16 wchar_t as chars if they are all ASCII.
+		*/
+		static inline bool storeNarrowed(const wchar_t* s, char* o)
+		{
+			const __m128i* v = reinterpret_cast<const __m128i*>(s);
+			__m128i packed;
+			if (sizeof(wchar_t) == 2)
+			{
+				__m128i a = _mm_loadu_si128(v);
+				__m128i b = _mm_loadu_si128(v + 1);
+				__m128i high = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi16(static_cast<short>(0xFF80)));
+				if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) != 0xFFFF)
+				{
+					return false;
+				}
+				packed = _mm_packus_epi16(a, b);
+			}
+			else
+			{
+				__m128i a = _mm_loadu_si128(v);
+				__m128i b = _mm_loadu_si128(v + 1);
+				__m128i c = _mm_loadu_si128(v + 2);
+				__m128i d = _mm_loadu_si128(v + 3);
+				__m128i all = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+				__m128i high = _mm_and_si128(all, _mm_set1_epi32(~0x7F));
+				if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) != 0xFFFF)
+				{
+					return false;
+				}
+				packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(o), packed);
+			return true;
+		}
+#endif
+	};
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface of TSTR<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template<typename CHARTYPE>
+	struct TSTR
+	{
+		typedef std::basic_string<CHARTYPE, std::char_traits<CHARTYPE>, std::allocator<CHARTYPE>> type;
+
+		static inline typename TSTR::type ToString(const char* utf8_str);
+		static inline typename TSTR::type ToString(const wchar_t* wstr);
+		static inline typename TSTR::type ToString(char c);
+		static inline typename TSTR::type ToString(wchar_t wc);
+	};
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Implementation of TSTR<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template<>
+	inline std::wstring TSTR<wchar_t>::ToString(const char* utf8_str)
+	{
+		std::wstring s;
+		Utf8::decode(utf8_str, std::char_traits<char>::length(utf8_str), s);
+		return s;
+	}
+
+	template<>
+	inline std::wstring TSTR<wchar_t>::ToString(const wchar_t* wstr)
+	{
+		return std::wstring(wstr);
+	}
+
+	template<>
+	inline std::wstring TSTR<wchar_t>::ToString(char c)
+	{
+		std::wstring s;
+		Utf8::decode(&c, 1, s);
+		return s;
+	}
+
+	template<>
+	inline std::wstring TSTR<wchar_t>::ToString(wchar_t wc)
+	{
+		wchar_t buf[] = {wc, 0};
+		return std::wstring(buf);
+	}
+
+	template<>
+	inline std::string TSTR<char>::ToString(const char* utf8_str)
+	{
+		return std::string(utf8_str);
+	}
+
+	template<>
+	inline std::string TSTR<char>::ToString(const wchar_t* wstr)
+	{
+		std::string s;
+		Utf8::encode(wstr, std::char_traits<wchar_t>::length(wstr), s);
+		return s;
+	}
+
+	template<>
+	inline std::string TSTR<char>::ToString(char c)
+	{
+		char buf[] = {c, 0};
+		return std::string(buf);
+	}
+
+	template<>
+	inline std::string TSTR<char>::ToString(wchar_t wc)
+	{
+		std::string s;
+		Utf8::encode(&wc, 1, s);
+		return s;
+	}
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface and implementation of TLITERAL<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+	/**
+		Pick the narrow or the wide spelling of a literal at compile time,
+		see ARGSTREAM_LITERAL.
+	*/
+	template<typename CHARTYPE>
+	struct TLITERAL;
+
+	template<>
+	struct TLITERAL<char>
+	{
+		static constexpr const char* select(const char* s, const wchar_t*) { return s; }
+	};
+
+	template<>
+	struct TLITERAL<wchar_t>
+	{
+		static constexpr const wchar_t* select(const char*, const wchar_t* s) { return s; }
+	};
+
+/**
+	The string literal s as a const CHARTYPE*, without any conversion at run
+	time: ARGSTREAM_LITERAL(CHARTYPE, "Usage: ").
+*/
+#define ARGSTREAM_LITERAL(CHARTYPE, s) ::argstream::TLITERAL<CHARTYPE>::select(s, L##s)
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface and implementation of TSTRVIEW<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template<typename CHARTYPE>
+	class TSTRVIEW
+	{
+	public:
+		typedef std::char_traits<CHARTYPE> traits_type;
+		typedef const CHARTYPE* const_iterator;
+		static const size_t npos = static_cast<size_t>(-1);
+
+		inline TSTRVIEW() : data_(nullptr), size_(0) {}
+		inline TSTRVIEW(const CHARTYPE* s, size_t n) : data_(s), size_(n) {}
+		inline TSTRVIEW(const CHARTYPE* s) : data_(s), size_(traits_type::length(s)) {}
+		template<typename ALLOC>
+		inline TSTRVIEW(const std::basic_string<CHARTYPE, std::char_traits<CHARTYPE>, ALLOC>& s)
+			: data_(s.data()), size_(s.size()) {}
+
+		inline const CHARTYPE* data() const { return data_; }
+		inline size_t size() const { return size_; }
+		inline bool empty() const { return size_ == 0; }
+		inline const_iterator begin() const { return data_; }
+		inline const_iterator end() const { return data_ + size_; }
+		inline CHARTYPE operator[](size_t i) const { return data_[i]; }
+
+		inline TSTRVIEW substr(size_t pos, size_t n = npos) const
+		{
+			if (pos > size_) pos = size_;
+			if (n > size_ - pos) n = size_ - pos;
+			return TSTRVIEW(data_ + pos, n);
+		}
+
+		/**
+			Copy the referenced characters into a string.
+		*/
+		inline typename TSTR<CHARTYPE>::type str() const
+		{
+			return typename TSTR<CHARTYPE>::type(data_, size_);
+		}
+
+		inline int compare(const TSTRVIEW& r) const
+		{
+			size_t n = size_ < r.size_ ? size_ : r.size_;
+			int c = n ? traits_type::compare(data_, r.data_, n) : 0;
+			if (c != 0) return c;
+			return size_ < r.size_ ? -1 : (size_ > r.size_ ? 1 : 0);
+		}
+
+		friend inline bool operator==(const TSTRVIEW& l, const TSTRVIEW& r)
+		{
+			return l.size_ == r.size_ && l.compare(r) == 0;
+		}
+		friend inline bool operator!=(const TSTRVIEW& l, const TSTRVIEW& r)
+		{
+			return !(l == r);
+		}
+		friend inline bool operator<(const TSTRVIEW& l, const TSTRVIEW& r)
+		{
+			return l.compare(r) < 0;
+		}
+		friend inline std::basic_ostream<CHARTYPE, std::char_traits<CHARTYPE> >&
+		operator<<(std::basic_ostream<CHARTYPE, std::char_traits<CHARTYPE> >& os, const TSTRVIEW& v)
+		{
+			return os.write(v.data_, v.size_);
+		}
+	private:
+		const CHARTYPE* data_;
+		size_t size_;
+	};
+
+	template<typename CHARTYPE>
+	const size_t TSTRVIEW<CHARTYPE>::npos;
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface and implementation of instrument<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+#ifdef ARGSTREAM_INSTRUMENT
+	typedef enum
+	{
+		PHASE_TOKENIZE = 0, // Splitting and indexing the command line, in the constructors
+		PHASE_BIND,         // One operator>>
+		PHASE_USAGE,        // usage()
+		PHASE_ERROR_LOG     // errorLog()
+	} PHASE;
+
+	template<typename CHARTYPE>
+	struct phase_record
+	{
+		PHASE phase;
+		TSTRVIEW<CHARTYPE> name;        // Long or short name of the option bound, if any
+		unsigned long long nanoseconds;
+		size_t allocations;             // Made through the counting_resource of the argstream,
+		size_t bytes;                   // zero if it has another resource
+	};
+
+	/**
+		Receive the timings of the phases of every argstream<CHARTYPE>, see
+		set_instrument(). Only available when ARGSTREAM_INSTRUMENT is
+		defined, otherwise the phases are not measured at all.
+	*/
+	template<typename CHARTYPE>
+	class instrument
+	{
+	public:
+		virtual ~instrument() {}
+		virtual void record(const phase_record<CHARTYPE>& r) = 0;
+	};
+
+	template<typename CHARTYPE>
+	inline std::atomic<instrument<CHARTYPE>*>& instrument_storage()
+	{
+		static std::atomic<instrument<CHARTYPE>*> i(nullptr);
+		return i;
+	}
+
+	/**
+		Install the instrument which receives the phases of all the
+		argstream<CHARTYPE> objects, NULL to stop measuring.
+	*/
+	template<typename CHARTYPE>
+	inline void set_instrument(instrument<CHARTYPE>* i)
+	{
+		instrument_storage<CHARTYPE>().store(i, std::memory_order_release);
+	}
+
+	/**
+		Measure a phase from its construction to its destruction.
+	*/
+	template<typename CHARTYPE>
+	class phase_timer
+	{
+	public:
+		inline phase_timer(PHASE phase, memory_resource* r, const TSTRVIEW<CHARTYPE>& name)
+			: instrument_(instrument_storage<CHARTYPE>().load(std::memory_order_acquire)),
+			counter_(NULL)
+		{
+			if (instrument_ == NULL)
+			{
+				return;
+			}
+			counter_ = dynamic_cast<counting_resource*>(r);
+			record_.phase = phase;
+			record_.name = name;
+			record_.allocations = counter_ != NULL ? counter_->allocations() : 0;
+			record_.bytes = counter_ != NULL ? counter_->bytes() : 0;
+			start_ = std::chrono::steady_clock::now();
+		}
+
+		inline ~phase_timer()
+		{
+			if (instrument_ == NULL)
+			{
+				return;
+			}
+			record_.nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start_).count();
+			record_.allocations = counter_ != NULL ? counter_->allocations() - record_.allocations : 0;
+			record_.bytes = counter_ != NULL ? counter_->bytes() - record_.bytes : 0;
+			instrument_->record(record_);
+		}
+	private:
+		phase_timer(const phase_timer&) = delete;
+		phase_timer& operator=(const phase_timer&) = delete;
+
+		instrument<CHARTYPE>* instrument_;
+		counting_resource* counter_;
+		phase_record<CHARTYPE> record_;
+		std::chrono::steady_clock::time_point start_;
+	};
+
+#define ARGSTREAM_PHASE(CHARTYPE, phase, resource, name) \
+	::argstream::phase_timer<CHARTYPE> argstream_phase_timer_(::argstream::phase, resource, name)
+#else
+#define ARGSTREAM_PHASE(CHARTYPE, phase, resource, name) ((void)0)
+#endif // ARGSTREAM_INSTRUMENT
+
+	/**
+		Read-only stream buffer over a TSTRVIEW, so that a value can be
+		extracted with operator>> without copying it into a string first.
+	*/
+	template<typename CHARTYPE>
+	class ViewBuffer : public std::basic_streambuf<CHARTYPE, std::char_traits<CHARTYPE> >
+	{
+	public:
+		inline explicit ViewBuffer(const TSTRVIEW<CHARTYPE>& s)
+		{
+			CHARTYPE* p = const_cast<CHARTYPE*>(s.data());
+			this->setg(p, p, p + s.size());
+		}
+	};
+
+	/**
+		@todo Expand this struct to hold file string and etc.
+	*/
+	template<typename CHARTYPE>
+	struct TSTRSTREAM
+	{
+		typedef std::basic_istringstream<CHARTYPE, std::char_traits<CHARTYPE>,std::allocator<CHARTYPE>> I;
+		typedef std::basic_ostringstream<CHARTYPE, std::char_traits<CHARTYPE>, std::allocator<CHARTYPE>> O;
+		typedef std::basic_ostream<CHARTYPE, std::char_traits<CHARTYPE> > COUT;
+	};
+
+#ifdef ARGSTREAM_DEBUG
+	/**
+		Stream of the ARGSTREAM_DEBUG traces.
+	*/
+	inline std::ostream& debugStream(char) { return std::clog; }
+	inline std::wostream& debugStream(wchar_t) { return std::wclog; }
+#endif
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface and implementation of the output sinks
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	//
+	// usage() and errorLog() write their text to a sink as segments: views
+	// of the declared strings, literals and short formatted pieces. A sink
+	// has put(view), put(character), number(n) and fill(character, n).
+
+	/**
+		Appends to a string.
+	*/
+	template<typename CHARTYPE, typename STRING>
+	class StringSink
+	{
+	public:
+		inline explicit StringSink(STRING& s) : s_(s) {}
+		inline void put(const TSTRVIEW<CHARTYPE>& v) { s_.append(v.data(), v.size()); }
+		inline void put(CHARTYPE c) { s_ += c; }
+		inline void fill(CHARTYPE c, size_t n) { s_.append(n, c); }
+		inline void number(long n)
+		{
+			typename TSTRSTREAM<CHARTYPE>::O os;
+			os << n;
+			put(os.str());
+		}
+	private:
+		STRING& s_;
+	};
+
+	/**
+		Writes to a stream.
+	*/
+	template<typename CHARTYPE>
+	class StreamSink
+	{
+	public:
+		inline explicit StreamSink(typename TSTRSTREAM<CHARTYPE>::COUT& os) : os_(os) {}
+		inline void put(const TSTRVIEW<CHARTYPE>& v) { os_.write(v.data(), v.size()); }
+		inline void put(CHARTYPE c) { os_.put(c); }
+		inline void fill(CHARTYPE c, size_t n) { while (n-- > 0) os_.put(c); }
+		inline void number(long n) { os_ << n; }
+	private:
+		typename TSTRSTREAM<CHARTYPE>::COUT& os_;
+	};
+
+#ifdef _WIN32
+	struct iovec
+	{
+		void* iov_base;
+		size_t iov_len;
+	};
+#endif
+
+	/**
+		Writes to a file descriptor with gathered writes, wchar_t text being
+		converted to UTF-8. The views longer than a few characters are
+		written from where they are, the other pieces are copied into a
+		small buffer; nothing is written before flush() or a full buffer.
+	*/
+	template<typename CHARTYPE>
+	class FdSink
+	{
+	public:
+		inline explicit FdSink(int fd) : fd_(fd), ok_(true), count_(0), used_(0) {}
+		inline void put(const TSTRVIEW<CHARTYPE>& v) { append(v.data(), v.size()); }
+		inline void put(CHARTYPE c) { append(&c, 1); }
+		inline void fill(CHARTYPE c, size_t n)
+		{
+			while (n > 0)
+			{
+				size_t chunk = std::min(n, static_cast<size_t>(SCRATCH));
+				reserve(chunk);
+				std::memset(scratch_ + used_, static_cast<char>(c), chunk);
+				copied(chunk);
+				n -= chunk;
+			}
+		}
+		inline void number(long n)
+		{
+			char text[32];
+			int l = snprintf(text, sizeof(text), "%ld", n);
+			copy(text, static_cast<size_t>(l));
+		}
+
+		/**
+			Write all the pending segments, return false if a write failed.
+		*/
+		inline bool flush()
+		{
+			iovec* v = segments_;
+			size_t n = count_;
+			while (ok_ && n > 0)
+			{
+				// Empty segments, such as an empty put(), are not written
+				if (v->iov_len == 0)
+				{
+					++v;
+					--n;
+					continue;
+				}
+#ifdef _WIN32
+				int r = _write(fd_, v->iov_base, static_cast<unsigned int>(v->iov_len));
+#else
+				ssize_t r = ::writev(fd_, v, static_cast<int>(n));
+				if (r < 0 && errno == EINTR)
+				{
+					continue;
+				}
+#endif
+				// Nothing written while bytes are pending would loop forever
+				if (r <= 0)
+				{
+					ok_ = false;
+					break;
+				}
+				// Skip what was written, a partial write resumes in a segment
+				size_t written = static_cast<size_t>(r);
+				while (n > 0 && written >= v->iov_len)
+				{
+					written -= v->iov_len;
+					++v;
+					--n;
+				}
+				if (n > 0)
+				{
+					v->iov_base = static_cast<char*>(v->iov_base) + written;
+					v->iov_len -= written;
+				}
+			}
+			count_ = 0;
+			used_ = 0;
+			return ok_;
+		}
+	private:
+		enum { SEGMENTS = 64, SCRATCH = 4096, REFERENCED = 64 };
+
+		inline void append(const char* s, size_t n)
+		{
+			if (n < REFERENCED)
+			{
+				copy(s, n);
+				return;
+			}
+			if (count_ == SEGMENTS)
+			{
+				flush();
+			}
+			segments_[count_].iov_base = const_cast<char*>(s);
+			segments_[count_].iov_len = n;
+			++count_;
+		}
+
+		inline void append(const wchar_t* s, size_t n)
+		{
+			while (n > 0)
+			{
+				size_t chunk = std::min(n, (SCRATCH - used_) / Utf8::maxEncodedSize(1));
+				// Do not split a surrogate pair between two chunks
+				if (chunk < n && chunk > 0 && sizeof(wchar_t) == 2 && (s[chunk - 1] & 0xFC00) == 0xD800)
+				{
+					--chunk;
+				}
+				if (chunk == 0 || count_ == SEGMENTS)
+				{
+					flush();
+					continue;
+				}
+				transcode_result r = Utf8::encode(s, chunk, scratch_ + used_);
+				copied(r.written);
+				s += chunk;
+				n -= chunk;
+			}
+		}
+
+		inline void copy(const char* s, size_t n)
+		{
+			reserve(n);
+			std::memcpy(scratch_ + used_, s, n);
+			copied(n);
+		}
+
+		inline void reserve(size_t n)
+		{
+			if (used_ + n > SCRATCH || count_ == SEGMENTS)
+			{
+				flush();
+			}
+		}
+
+		// n characters were written at scratch_ + used_, after reserve():
+		// extend the last segment when it ends there.
+		inline void copied(size_t n)
+		{
+			if (count_ > 0 &&
+				static_cast<char*>(segments_[count_ - 1].iov_base) + segments_[count_ - 1].iov_len == scratch_ + used_)
+			{
+				segments_[count_ - 1].iov_len += n;
+			}
+			else
+			{
+				segments_[count_].iov_base = scratch_ + used_;
+				segments_[count_].iov_len = n;
+				++count_;
+			}
+			used_ += n;
+		}
+
+		int fd_;
+		bool ok_;
+		iovec segments_[SEGMENTS];
+		size_t count_;
+		char scratch_[SCRATCH];
+		size_t used_;
+	};
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface of ValueHolder<CHARTYPE, T>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template<typename CHARTYPE, typename T>
+	class ValueHolder
+	{
+	public:
+		ValueHolder(CHARTYPE s,
+			const CHARTYPE* l,
+			T& b,
+			const CHARTYPE* desc,
+			bool mandatory,
+			const CHARTYPE* env = NULL);
+		ValueHolder(const CHARTYPE* l,
+			T& b,
+			const CHARTYPE* desc,
+			bool mandatory);
+		ValueHolder(CHARTYPE s,
+			T& b,
+			const CHARTYPE* desc,
+			bool mandatory);
+
+		template<typename C, typename T2>
+		friend argstream<C>& operator>>(argstream<C>& s, ValueHolder<C, T2> const& v);
+
+		template<typename C, typename T2>
+		friend schema<C>& operator>>(schema<C>& s, ValueHolder<C, T2> const& v);
+
+		friend struct description_policy<CHARTYPE, T>;
+		friend class argstream<CHARTYPE>;
+
+		typename TSTR<CHARTYPE>::type name() const;
+		typename TSTR<CHARTYPE>::type description() const;
+	private:
+		// The names and the description refer to the strings given to the
+		// constructor, they are not copied.
+		typename TSTR<CHARTYPE>::type shortName_;
+		TSTRVIEW<CHARTYPE> longName_;
+		T* value_;
+		T initialValue_;
+		TSTRVIEW<CHARTYPE> description_;
+		bool mandatory_;
+		TSTRVIEW<CHARTYPE> env_; // Read when the option is missing, empty if none
+	};
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Implementation of ValueHodler<CHARTYPE, T>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template<typename CHARTYPE, typename T>
+	ValueHolder<CHARTYPE, T>::ValueHolder(
+		CHARTYPE s,
+		const CHARTYPE* l,
+		T& v,
+		const CHARTYPE* desc,
+		bool mandatory,
+		const CHARTYPE* env)
+		:  shortName_(1,s),
+		longName_(l),
+		value_(&v),
+		initialValue_(v),
+		description_(desc),
+		mandatory_(mandatory),
+		env_(env != NULL ? TSTRVIEW<CHARTYPE>(env) : TSTRVIEW<CHARTYPE>())
+	{
+	}
+	template<typename CHARTYPE, typename T>
+	ValueHolder<CHARTYPE, T>::ValueHolder(
+		const CHARTYPE* l,
+		T& v,
+		const CHARTYPE* desc,
+		bool mandatory)
+		:  longName_(l),
+		value_(&v),
+		initialValue_(v),
+		description_(desc),
+		mandatory_(mandatory)
+	{
+	}
+	template<typename CHARTYPE, typename T>
+	ValueHolder<CHARTYPE, T>::ValueHolder(CHARTYPE s,
+		T& v,
+		const CHARTYPE* desc,
 		bool mandatory)
 		:  shortName_(1,s),
+		value_(&v),
+		initialValue_(v),
+		description_(desc),
+		mandatory_(mandatory)
+	{
+	}
+	template<typename CHARTYPE, typename T>
+	typename TSTR<CHARTYPE>::type ValueHolder<CHARTYPE, T>::name() const
+	{
+		typename TSTRSTREAM<CHARTYPE>::O os;
+		if (!shortName_.empty()) os<<'-'<<shortName_;
+		if (!longName_.empty()) {
+			if (!shortName_.empty()) os<<'/';
+			os<<ARGSTREAM_LITERAL(CHARTYPE, "--")<<longName_;
+		}
+		return os.str();
+	}
+
+	template<typename CHARTYPE, typename T>
+	inline typename TSTR<CHARTYPE>::type ValueHolder<CHARTYPE, T>::description() const
+	{
+		return description_.str();
+	}
+
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface of CopyrightHolder<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template <typename CHARTYPE>
+	class CopyrightHolder
+	{
+	public:
+		inline CopyrightHolder(const CHARTYPE* copyright);
+		inline typename TSTR<CHARTYPE>::type copyright() const;
+
+		template<typename C>
+		friend argstream<C>& operator>>(argstream<C>& s, CopyrightHolder<C> const& e);
+	private:
+		TSTRVIEW<CHARTYPE> copyright_;
+	};
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Implementation of CopyrightHolder<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template<typename CHARTYPE>
+	inline CopyrightHolder<CHARTYPE>::CopyrightHolder(const CHARTYPE* copyright)
+		:copyright_(copyright)
+	{
+	}
+
+	template<typename CHARTYPE>
+	inline typename TSTR<CHARTYPE>::type CopyrightHolder<CHARTYPE>::copyright() const
+	{
+		return copyright_.str();
+	}
+
+	template<typename CHARTYPE>
+	inline argstream<CHARTYPE>&
+    operator >>(argstream<CHARTYPE>& s, CopyrightHolder<CHARTYPE> const& v)
+	{
+		ARGSTREAM_PHASE(CHARTYPE, PHASE_BIND, s.resource_, TSTRVIEW<CHARTYPE>());
+		s.copyright_ = v.copyright_;
+		s.usageValid_ = false;
+		return s;
+	}
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface of ExampleHolder<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template <typename CHARTYPE>
+	class ExampleHolder
+	{
+	public:
+		ExampleHolder(const CHARTYPE* cmdline, const CHARTYPE* desc);
+		typename TSTR<CHARTYPE>::type cmdline() const;
+		typename TSTR<CHARTYPE>::type description() const;
+		template<typename C>
+		friend argstream<C>& operator>>(argstream<C>& s, ExampleHolder<C> const& e);
+	private:
+		TSTRVIEW<CHARTYPE> cmdline_;
+		TSTRVIEW<CHARTYPE> description_;
+	};
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Implementation of ExampleHolder<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template<typename CHARTYPE>
+	ExampleHolder<CHARTYPE>::ExampleHolder(const CHARTYPE* cmdline, const CHARTYPE* desc)
+		:cmdline_(cmdline), description_(desc)
+	{
+	}
+
+	template<typename CHARTYPE>
+	typename TSTR<CHARTYPE>::type
+    ExampleHolder<CHARTYPE>::cmdline() const
+	{
+		return cmdline_.str();
+	}
+
+	template<typename CHARTYPE>
+	typename TSTR<CHARTYPE>::type ExampleHolder<CHARTYPE>::description() const
+	{
+		return description_.str();
+	}
+
+	template<typename CHARTYPE>
+	inline argstream<CHARTYPE>&
+    operator >>(argstream<CHARTYPE>& s, ExampleHolder<CHARTYPE> const& v)
+	{
+		ARGSTREAM_PHASE(CHARTYPE, PHASE_BIND, s.resource_, TSTRVIEW<CHARTYPE>());
+		s.examples_.push_back(typename argstream<CHARTYPE>::example_entry(v.cmdline_, v.description_));
+		s.usageValid_ = false;
+		return s;
+	}
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface of OptionHolder<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template <typename CHARTYPE>
+	class OptionHolder
+	{
+	public:
+		inline OptionHolder(
+			CHARTYPE s,
+			const CHARTYPE* l,
+			bool& b,
+			const CHARTYPE* desc,
+			const CHARTYPE* env = NULL);
+		inline OptionHolder(
+			const CHARTYPE* l,
+			bool& b,
+			const CHARTYPE* desc);
+		inline OptionHolder(
+			CHARTYPE s,
+			bool& b,
+			const CHARTYPE* desc);
+		inline OptionHolder(CHARTYPE s,
+			const CHARTYPE* l,
+			const CHARTYPE* desc);
+
+		inline typename TSTR<CHARTYPE>::type name() const;
+		inline typename TSTR<CHARTYPE>::type description() const;
+
+		template<typename C>
+		friend argstream<C>& operator>>(argstream<C>& s, OptionHolder<C> const& v);
+
+		template<typename C>
+		friend schema<C>& operator>>(schema<C>& s, OptionHolder<C> const& v);
+
+		friend OptionHolder<CHARTYPE> help<CHARTYPE>();
+		friend class argstream<CHARTYPE>;
+	private:
+		typename TSTR<CHARTYPE>::type shortName_;
+		TSTRVIEW<CHARTYPE> longName_;
+		bool* value_;
+		TSTRVIEW<CHARTYPE> description_;
+		TSTRVIEW<CHARTYPE> env_; // Read when the option is missing, empty if none
+	};
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Implementation of OptionHolder<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template<typename CHARTYPE>
+	inline OptionHolder<CHARTYPE>::OptionHolder(
+		CHARTYPE s,
+		const CHARTYPE* l,
+		bool& b,
+		const CHARTYPE* desc,
+		const CHARTYPE* env)
+		: shortName_(1,s),
 		longName_(l),
-		value_(&v),
-		initialValue_(v),
+		value_(&b),
 		description_(desc),
-		mandatory_(mandatory)
+		env_(env != NULL ? TSTRVIEW<CHARTYPE>(env) : TSTRVIEW<CHARTYPE>())
+	{
+	}
+
+	template<typename CHARTYPE>
+	inline OptionHolder<CHARTYPE>::OptionHolder(
+		const CHARTYPE* l,
+		bool& b,
+		const CHARTYPE* desc)
+		: longName_(l),
+		value_(&b),
+		description_(desc)
+	{
+	}
+
+	template<typename CHARTYPE>
+	inline OptionHolder<CHARTYPE>::OptionHolder(
+		CHARTYPE s,
+		bool& b,
+		const CHARTYPE* desc)
+		: shortName_(1,s),
+		value_(&b),
+		description_(desc)
+	{
+	}
+
+	template<typename CHARTYPE>
+	inline OptionHolder<CHARTYPE>::OptionHolder(
+		CHARTYPE s,
+		const CHARTYPE* l,
+		const CHARTYPE* desc)
+		: shortName_(1,s),
+		longName_(l),
+		value_(NULL),
+		description_(desc)
+	{
+	}
+
+	template<typename CHARTYPE>
+	inline typename TSTR<CHARTYPE>::type OptionHolder<CHARTYPE>::name() const
+	{
+		typename TSTRSTREAM<CHARTYPE>::O os;
+		if (!shortName_.empty()) os<<'-'<<shortName_;
+		if (!longName_.empty())
+		{
+			if (!shortName_.empty()) os<<'/';
+			os<<ARGSTREAM_LITERAL(CHARTYPE, "--")<<longName_;
+		}
+		return os.str();
+	}
+
+	template<typename CHARTYPE>
+	inline typename TSTR<CHARTYPE>::type OptionHolder<CHARTYPE>::description() const
+	{
+		return description_.str();
+	}
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface of ValuesHolder<CHARTYPE, T, O>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	/**
+		Positional values, parsed as T and written to the output iterator
+		O, or appended to the vector when O is a pointer to std::vector.
+		len is the number of values expected, -1 to take all of them.
+		source, if any, gives the values which follow those of argv.
+	*/
+	template<typename CHARTYPE, typename T, typename O>
+	class ValuesHolder
+	{
+	public:
+		ValuesHolder(const O& o,
+			const CHARTYPE* desc,
+			int len,
+			NulReader<CHARTYPE>* source = NULL);
+
+		template<typename C, typename T2, typename O2>
+		friend argstream<C>& operator>>(argstream<C>& s, ValuesHolder<C, T2, O2> const& v);
+		friend class argstream<CHARTYPE>;
+
+		typename TSTR<CHARTYPE>::type description() const;
+		typedef T value_type;
+	private:
+		mutable O value_;
+		TSTRVIEW<CHARTYPE> description_;
+		int len_;
+		NulReader<CHARTYPE>* source_; // Read once the values of argv are taken, NULL if none
+	};
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Implementation of ValuesHolder<CHARTYPE, T, O>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template<typename CHARTYPE, typename T, typename O>
+	ValuesHolder<CHARTYPE, T, O>::ValuesHolder(
+		const O& o,
+		const CHARTYPE* desc,
+		int len,
+		NulReader<CHARTYPE>* source)
+		: value_(o),
+		description_(desc),
+		len_(len),
+		source_(source)
+	{
+	}
+
+	template <typename CHARTYPE, typename T, typename O>
+	typename TSTR<CHARTYPE>::type
+	ValuesHolder<CHARTYPE, T, O>::description() const
+	{
+		return description_.str();
+	}
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface and implementation of ValueParser<CHARTYPE, T>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	//
+	// A parser converts the text of an argument to a value of type T. It
+	// returns false if the text is not a valid T, in which case t is left
+	// untouched.
+	template<typename CHARTYPE, typename T>
+	class ValueParser
+	{
+	public:
+		inline bool operator ()(const TSTRVIEW<CHARTYPE>& s, T& t) const
+		{
+			ViewBuffer<CHARTYPE> buf(s);
+			std::basic_istream<CHARTYPE, std::char_traits<CHARTYPE> > is(&buf);
+			T v;
+			is>>v;
+			if (is.fail())
+			{
+				return false;
+			}
+			t = v;
+			return true;
+		}
+	};
+
+	// The only place where an argument is copied into a string.
+	template<typename CHARTYPE>
+	class ValueParser<CHARTYPE, typename TSTR<CHARTYPE>::type>
+	{
+	public:
+		inline bool
+		operator ()(const TSTRVIEW<CHARTYPE>& s, typename TSTR<CHARTYPE>::type& t) const
+		{
+			t = s.str();
+			return true;
+		}
+	};
+
+	/**
+		Parse a decimal integer directly from the characters, without stream
+		nor locale. Spaces and tabs before and after the number are skipped,
+		anything else than digits after the optional sign, as well as values
+		out of the range of T, are rejected.
+	*/
+	template<typename CHARTYPE, typename T>
+	class IntegerParser
+	{
+	public:
+		inline bool operator ()(const TSTRVIEW<CHARTYPE>& s, T& t) const
+		{
+			const CHARTYPE* p = s.begin();
+			const CHARTYPE* end = s.end();
+			// Blanks around the number are ignored on both sides
+			while (p != end && (*p == ' ' || *p == '\t'))
+			{
+				++p;
+			}
+			while (end != p && (end[-1] == ' ' || end[-1] == '\t'))
+			{
+				--end;
+			}
+			bool negative = false;
+			if (p != end && (*p == '-' || *p == '+'))
+			{
+				negative = (*p++ == '-');
+			}
+			if (p == end)
+			{
+				return false;
+			}
+			// Largest magnitude allowed, the minimum of a signed type has one
+			// more than its maximum.
+			unsigned long long limit = static_cast<unsigned long long>(std::numeric_limits<T>::max());
+			if (negative)
+			{
+				if (!std::numeric_limits<T>::is_signed)
+				{
+					return false;
+				}
+				limit += 1;
+			}
+			unsigned long long v = 0;
+			for (; p != end; ++p)
+			{
+				if (*p < '0' || *p > '9')
+				{
+					return false;
+				}
+				unsigned long long d = static_cast<unsigned long long>(*p - '0');
+				if (v > (limit - d) / 10)
+				{
+					return false; // Overflow
+				}
+				v = v * 10 + d;
+			}
+			if (negative && v != 0)
+			{
+				// -(v-1)-1 does not overflow for the minimum of T.
+				t = static_cast<T>(-static_cast<T>(v - 1) - 1);
+			}
+			else
+			{
+				t = static_cast<T>(v);
+			}
+			return true;
+		}
+	};
+
+	/**
+		Parse a decimal floating point number ([+-]digits[.digits][e[+-]digits])
+		directly from the characters. The result is computed exactly when
+		the mantissa and the power of ten are small enough to be represented
+		without rounding in T, which covers most of the command line values.
+		The other numbers are converted with a stream using the classic
+		locale, so that the result is correctly rounded too.
+	*/
+	template<typename CHARTYPE, typename T>
+	class FloatParser
+	{
+	public:
+		inline bool operator ()(const TSTRVIEW<CHARTYPE>& s, T& t) const
+		{
+			const CHARTYPE* p = s.begin();
+			const CHARTYPE* end = s.end();
+			// Blanks around the number are ignored on both sides
+			while (p != end && (*p == ' ' || *p == '\t'))
+			{
+				++p;
+			}
+			while (end != p && (end[-1] == ' ' || end[-1] == '\t'))
+			{
+				--end;
+			}
+			const CHARTYPE* begin = p;
+			bool negative = false;
+			if (p != end && (*p == '-' || *p == '+'))
+			{
+				negative = (*p++ == '-');
+			}
+			unsigned long long mantissa = 0;
+			int digits = 0;      // Significant digits in the mantissa
+			int exponent = 0;    // Power of ten applied to the mantissa
+			bool anyDigit = false;
+			bool exact = true;
+			for (; p != end && *p >= '0' && *p <= '9'; ++p)
+			{
+				anyDigit = true;
+				if (digits < 19)
+				{
+					mantissa = mantissa * 10 + static_cast<unsigned long long>(*p - '0');
+					if (mantissa) ++digits;
+				}
+				else
+				{
+					exact = false;
+				}
+			}
+			if (p != end && *p == '.')
+			{
+				for (++p; p != end && *p >= '0' && *p <= '9'; ++p)
+				{
+					anyDigit = true;
+					if (digits < 19)
+					{
+						mantissa = mantissa * 10 + static_cast<unsigned long long>(*p - '0');
+						if (mantissa) ++digits;
+						--exponent;
+					}
+					else
+					{
+						exact = false;
+					}
+				}
+			}
+			if (!anyDigit)
+			{
+				return false;
+			}
+			if (p != end && (*p == 'e' || *p == 'E'))
+			{
+				++p;
+				bool negativeExp = false;
+				if (p != end && (*p == '-' || *p == '+'))
+				{
+					negativeExp = (*p++ == '-');
+				}
+				if (p == end)
+				{
+					return false;
+				}
+				int e = 0;
+				for (; p != end && *p >= '0' && *p <= '9'; ++p)
+				{
+					if (e < 100000) e = e * 10 + (*p - '0');
+				}
+				exponent += negativeExp ? -e : e;
+			}
+			if (p != end)
+			{
+				return false; // Trailing characters
+			}
+			if (exact &&
+				mantissa <= (1ULL << exactMantissaBits()) &&
+				exponent >= -maxExactPower() && exponent <= maxExactPower())
+			{
+				static const T powers[] = {
+					T(1e0), T(1e1), T(1e2), T(1e3), T(1e4), T(1e5), T(1e6), T(1e7),
+					T(1e8), T(1e9), T(1e10), T(1e11), T(1e12), T(1e13), T(1e14),
+					T(1e15), T(1e16), T(1e17), T(1e18), T(1e19), T(1e20), T(1e21),
+					T(1e22)
+				};
+				T v = static_cast<T>(mantissa);
+				v = exponent < 0 ? v / powers[-exponent] : v * powers[exponent];
+				t = negative ? -v : v;
+				return true;
+			}
+			return slowPath(begin, end, t);
+		}
+	private:
+		static inline int exactMantissaBits()
+		{
+			return std::numeric_limits<T>::digits < 53 ? std::numeric_limits<T>::digits : 53;
+		}
+		static inline int maxExactPower()
+		{
+			return std::numeric_limits<T>::digits < 53 ? 10 : 22;
+		}
+		static inline bool slowPath(const CHARTYPE* begin, const CHARTYPE* end, T& t)
+		{
+			// The characters have been checked above, they are all ASCII.
+			std::string narrow(begin, end);
+			std::istringstream is(narrow);
+			is.imbue(std::locale::classic());
+			T v;
+			is >> v;
+			if (is.fail())
+			{
+				return false; // Out of range
+			}
+			t = v;
+			return true;
+		}
+	};
+
+	template<typename CHARTYPE>
+	class ValueParser<CHARTYPE, short> : public IntegerParser<CHARTYPE, short> {};
+	template<typename CHARTYPE>
+	class ValueParser<CHARTYPE, unsigned short> : public IntegerParser<CHARTYPE, unsigned short> {};
+	template<typename CHARTYPE>
+	class ValueParser<CHARTYPE, int> : public IntegerParser<CHARTYPE, int> {};
+	template<typename CHARTYPE>
+	class ValueParser<CHARTYPE, unsigned int> : public IntegerParser<CHARTYPE, unsigned int> {};
+	template<typename CHARTYPE>
+	class ValueParser<CHARTYPE, long> : public IntegerParser<CHARTYPE, long> {};
+	template<typename CHARTYPE>
+	class ValueParser<CHARTYPE, unsigned long> : public IntegerParser<CHARTYPE, unsigned long> {};
+	template<typename CHARTYPE>
+	class ValueParser<CHARTYPE, long long> : public IntegerParser<CHARTYPE, long long> {};
+	template<typename CHARTYPE>
+	class ValueParser<CHARTYPE, unsigned long long> : public IntegerParser<CHARTYPE, unsigned long long> {};
+	template<typename CHARTYPE>
+	class ValueParser<CHARTYPE, float> : public FloatParser<CHARTYPE, float> {};
+	template<typename CHARTYPE>
+	class ValueParser<CHARTYPE, double> : public FloatParser<CHARTYPE, double> {};
+	template<typename CHARTYPE>
+	class ValueParser<CHARTYPE, long double> : public FloatParser<CHARTYPE, long double> {};
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface and implementation of Scanner<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+#ifdef ARGSTREAM_SIMD_SSE2
+	/**
+		Lanes holding a space or a control character, a quote or a
+		backslash, for characters of SIZE bytes.
+	*/
+	template<size_t SIZE>
+	struct SimdStops;
+
+	template<>
+	struct SimdStops<1>
+	{
+		static inline __m128i find(__m128i x)
+		{
+			__m128i blank = _mm_cmpeq_epi8(_mm_subs_epu8(x, _mm_set1_epi8(0x20)), _mm_setzero_si128());
+			__m128i quotes = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('"')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\'')));
+			return _mm_or_si128(_mm_or_si128(blank, quotes), _mm_cmpeq_epi8(x, _mm_set1_epi8('\\')));
+		}
+#ifdef ARGSTREAM_SIMD_AVX2
+		static inline ARGSTREAM_TARGET_AVX2 __m256i find(__m256i x)
+		{
+			__m256i blank = _mm256_cmpeq_epi8(_mm256_subs_epu8(x, _mm256_set1_epi8(0x20)), _mm256_setzero_si256());
+			__m256i quotes = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\'')));
+			return _mm256_or_si256(_mm256_or_si256(blank, quotes), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\')));
+		}
+#endif
+	};
+
+	template<>
+	struct SimdStops<2>
+	{
+		static inline __m128i find(__m128i x)
+		{
+			__m128i blank = _mm_cmpeq_epi16(_mm_subs_epu16(x, _mm_set1_epi16(0x20)), _mm_setzero_si128());
+			__m128i quotes = _mm_or_si128(_mm_cmpeq_epi16(x, _mm_set1_epi16('"')), _mm_cmpeq_epi16(x, _mm_set1_epi16('\'')));
+			return _mm_or_si128(_mm_or_si128(blank, quotes), _mm_cmpeq_epi16(x, _mm_set1_epi16('\\')));
+		}
+#ifdef ARGSTREAM_SIMD_AVX2
+		static inline ARGSTREAM_TARGET_AVX2 __m256i find(__m256i x)
+		{
+			__m256i blank = _mm256_cmpeq_epi16(_mm256_subs_epu16(x, _mm256_set1_epi16(0x20)), _mm256_setzero_si256());
+			__m256i quotes = _mm256_or_si256(_mm256_cmpeq_epi16(x, _mm256_set1_epi16('"')), _mm256_cmpeq_epi16(x, _mm256_set1_epi16('\'')));
+			return _mm256_or_si256(_mm256_or_si256(blank, quotes), _mm256_cmpeq_epi16(x, _mm256_set1_epi16('\\')));
+		}
+#endif
+	};
+
+	template<>
+	struct SimdStops<4>
+	{
+		// There is no unsigned 32 bits comparison before SSE4.1, flipping
+		// the sign bits turns a signed one into it.
+		static inline __m128i find(__m128i x)
+		{
+			__m128i sign = _mm_set1_epi32(static_cast<int>(0x80000000u));
+			__m128i blank = _mm_cmplt_epi32(_mm_xor_si128(x, sign), _mm_xor_si128(_mm_set1_epi32(0x21), sign));
+			__m128i quotes = _mm_or_si128(_mm_cmpeq_epi32(x, _mm_set1_epi32('"')), _mm_cmpeq_epi32(x, _mm_set1_epi32('\'')));
+			return _mm_or_si128(_mm_or_si128(blank, quotes), _mm_cmpeq_epi32(x, _mm_set1_epi32('\\')));
+		}
+#ifdef ARGSTREAM_SIMD_AVX2
+		static inline ARGSTREAM_TARGET_AVX2 __m256i find(__m256i x)
+		{
+			__m256i sign = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+			__m256i blank = _mm256_cmpgt_epi32(_mm256_xor_si256(_mm256_set1_epi32(0x21), sign), _mm256_xor_si256(x, sign));
+			__m256i quotes = _mm256_or_si256(_mm256_cmpeq_epi32(x, _mm256_set1_epi32('"')), _mm256_cmpeq_epi32(x, _mm256_set1_epi32('\'')));
+			return _mm256_or_si256(_mm256_or_si256(blank, quotes), _mm256_cmpeq_epi32(x, _mm256_set1_epi32('\\')));
+		}
+#endif
+	};
+#endif
+
+	/**
+		Find the characters which need attention when splitting a command
+		line: spaces and control characters, quotes and backslashes. The
+		runs of other characters are skipped 16 or 32 bytes at a time.
+	*/
+	template<typename CHARTYPE>
+	class Scanner
+	{
+	public:
+		/**
+			@return The first stop character in [p, end), or end.
+		*/
+		static inline const CHARTYPE* find(const CHARTYPE* p, const CHARTYPE* end)
+		{
+			return find(p, end, simd_level());
+		}
+
+		static inline const CHARTYPE* find(const CHARTYPE* p, const CHARTYPE* end, SIMD_LEVEL level)
+		{
+#ifdef ARGSTREAM_SIMD_AVX2
+			if (level >= SIMD_AVX2) return findAvx2(p, end);
+#endif
+#ifdef ARGSTREAM_SIMD_SSE2
+			if (level >= SIMD_SSE2) return findSse2(p, end);
+#endif
+			(void)level;
+			return findScalar(p, end);
+		}
+
+		static inline bool isStop(CHARTYPE c)
+		{
+			typedef typename std::make_unsigned<CHARTYPE>::type unsigned_type;
+			return static_cast<unsigned_type>(c) <= 0x20 || c == '"' || c == '\'' || c == '\\';
+		}
+	private:
+		static inline const CHARTYPE* findScalar(const CHARTYPE* p, const CHARTYPE* end)
+		{
+			while (p < end && !isStop(*p))
+			{
+				++p;
+			}
+			return p;
+		}
+#ifdef ARGSTREAM_SIMD_SSE2
+		static inline const CHARTYPE* findSse2(const CHARTYPE* p, const CHARTYPE* end)
+		{
+			const size_t lanes = sizeof(__m128i) / sizeof(CHARTYPE);
+			while (static_cast<size_t>(end - p) >= lanes)
+			{
+				__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+				unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(SimdStops<sizeof(CHARTYPE)>::find(x)));
+				if (mask != 0)
+				{
+					return p + firstBit(mask) / sizeof(CHARTYPE);
+				}
+				p += lanes;
+			}
+			return findScalar(p, end);
+		}
+#endif
+#ifdef ARGSTREAM_SIMD_AVX2
+		static inline ARGSTREAM_TARGET_AVX2 const CHARTYPE* findAvx2(const CHARTYPE* p, const CHARTYPE* end)
+		{
+			const size_t lanes = sizeof(__m256i) / sizeof(CHARTYPE);
+			while (static_cast<size_t>(end - p) >= lanes)
+			{
+				__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+				unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(SimdStops<sizeof(CHARTYPE)>::find(x)));
+				if (mask != 0)
+				{
+					return p + firstBit(mask) / sizeof(CHARTYPE);
+				}
+				p += lanes;
+			}
+			return findSse2(p, end);
+		}
+#endif
+	};
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface of MappedFile
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+	/**
+		A whole file in memory, followed by a zero so that it can be split
+		like a command line string. The file is mapped privately and
+		writable: unescaping arguments in place only copies the pages
+		written to, the file itself is never modified. Where mmap() is not
+		available the file is read instead, into memory of the resource.
+	*/
+	class MappedFile
+	{
+	public:
+		inline explicit MappedFile(memory_resource* r = new_delete_resource());
+		inline ~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		/**
+			@param path Path of the file, in UTF-8.
+			@return false if the file cannot be opened, is not a regular
+			        file or cannot be mapped.
+		*/
+		inline bool open(const char* path);
+
+		/**
+			Unmap the file. sameFile() still compares it with other files.
+		*/
+		inline void release();
+
+		inline char* data() const;
+		inline size_t size() const;
+
+		/**
+			Whether both objects hold the same file, possibly opened through
+			different paths or links.
+		*/
+		inline bool sameFile(const MappedFile& other) const;
+	private:
+		memory_resource* resource_;
+		char* data_;
+		size_t size_;
+		size_t mapped_;    // Bytes mapped, 0 if data_ was read
+		size_t allocated_; // Bytes allocated from resource_ to read the file
+#ifdef _WIN32
+		std::wstring path_; // Full path, the identity of the file
+#else
+		dev_t device_;
+		ino_t inode_;
+#endif
+	};
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Implementation of MappedFile
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	inline MappedFile::MappedFile(memory_resource* r)
+		: resource_(r),
+		data_(NULL),
+		size_(0),
+		mapped_(0),
+		allocated_(0)
+#ifndef _WIN32
+		, device_(0),
+		inode_(0)
+#endif
+	{
+	}
+
+	inline MappedFile::~MappedFile()
+	{
+		release();
+	}
+
+	inline bool
+	MappedFile::open(const char* path)
+	{
+		release();
+#ifdef _WIN32
+		std::wstring wpath = TSTR<wchar_t>::ToString(path);
+		wchar_t full[_MAX_PATH];
+		path_ = _wfullpath(full, wpath.c_str(), _MAX_PATH) != NULL ? full : wpath;
+		FILE* f = _wfopen(wpath.c_str(), L"rb");
+		if (f == NULL)
+		{
+			return false;
+		}
+		bool ok = _fseeki64(f, 0, SEEK_END) == 0;
+		long long size = ok ? _ftelli64(f) : -1;
+		if (size < 0 || _fseeki64(f, 0, SEEK_SET) != 0)
+		{
+			fclose(f);
+			return false;
+		}
+		allocated_ = static_cast<size_t>(size) + 1;
+		data_ = static_cast<char*>(resource_->allocate(allocated_, 1));
+		size_ = fread(data_, 1, static_cast<size_t>(size), f);
+		data_[size_] = 0;
+		fclose(f);
+		return true;
+#else
+		int fd = ::open(path, O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+		{
+			::close(fd);
+			return false;
+		}
+		// Reserve at least one byte more than the file. Past the end of the
+		// file the last page reads as zeros, and if the file fills it the
+		// next page is anonymous, zeros too.
+		size_t size = static_cast<size_t>(st.st_size);
+#ifdef ARGSTREAM_NO_MMAP
+		allocated_ = size + 1;
+		data_ = static_cast<char*>(resource_->allocate(allocated_, 1));
+		size_t done = 0;
+		while (done < size)
+		{
+			ssize_t n = ::read(fd, data_ + done, size - done);
+			if (n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (n <= 0)
+			{
+				break;
+			}
+			done += static_cast<size_t>(n);
+		}
+		::close(fd);
+		size_ = done;
+		data_[size_] = 0;
+#else
+		size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		size_t mapped = (size / page + 1) * page;
+		void* p = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p != MAP_FAILED && size > 0 &&
+			mmap(p, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+		{
+			munmap(p, mapped);
+			p = MAP_FAILED;
+		}
+		::close(fd);
+		if (p == MAP_FAILED)
+		{
+			return false;
+		}
+		posix_madvise(p, size, POSIX_MADV_SEQUENTIAL);
+		data_ = static_cast<char*>(p);
+		size_ = size;
+		mapped_ = mapped;
+#endif
+		device_ = st.st_dev;
+		inode_ = st.st_ino;
+		return true;
+#endif
+	}
+
+	inline void
+	MappedFile::release()
+	{
+		if (data_ == NULL)
+		{
+			return;
+		}
+#if !defined(_WIN32) && !defined(ARGSTREAM_NO_MMAP)
+		if (mapped_ != 0)
+		{
+			munmap(data_, mapped_);
+		}
+		else
+#endif
+		{
+			resource_->deallocate(data_, allocated_, 1);
+		}
+		data_ = NULL;
+		size_ = 0;
+		mapped_ = 0;
+		allocated_ = 0;
+	}
+
+	inline char*
+	MappedFile::data() const
+	{
+		return data_;
+	}
+
+	inline size_t
+	MappedFile::size() const
+	{
+		return size_;
+	}
+
+	inline bool
+	MappedFile::sameFile(const MappedFile& other) const
+	{
+#ifdef _WIN32
+		return !path_.empty() && _wcsicmp(path_.c_str(), other.path_.c_str()) == 0;
+#else
+		return inode_ != 0 && device_ == other.device_ && inode_ == other.inode_;
+#endif
+	}
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface and implementation of FileText<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+	/**
+		The text of a file as a zero terminated CHARTYPE string. For char it
+		is the mapping itself. For wchar_t the file is decoded from UTF-8
+		into buffer, then unmapped. view() does the same for n bytes read
+		from a file, without the zero, and copy() into a buffer of the
+		caller holding capacity() characters.
+	*/
+	template<typename CHARTYPE>
+	struct FileText;
+
+	template<>
+	struct FileText<char>
+	{
+		template<typename BUFFER>
+		static inline char* load(MappedFile& f, BUFFER&, size_t& size)
+		{
+			size = f.size();
+			return f.data();
+		}
+
+		template<typename BUFFER>
+		static inline TSTRVIEW<char> view(const char* s, size_t n, BUFFER&)
+		{
+			return TSTRVIEW<char>(s, n);
+		}
+
+		static inline size_t capacity(size_t n)
+		{
+			return n;
+		}
+
+		static inline size_t copy(const char* s, size_t n, char* out)
+		{
+			std::memcpy(out, s, n);
+			return n;
+		}
+	};
+
+	template<>
+	struct FileText<wchar_t>
+	{
+		template<typename BUFFER>
+		static inline wchar_t* load(MappedFile& f, BUFFER& buffer, size_t& size)
+		{
+			buffer.resize(Utf8::maxDecodedSize(f.size()) + 1);
+			size = Utf8::decode(f.data(), f.size(), &buffer[0]).written;
+			buffer[size] = 0;
+			f.release();
+			return &buffer[0];
+		}
+
+		template<typename BUFFER>
+		static inline TSTRVIEW<wchar_t> view(const char* s, size_t n, BUFFER& buffer)
+		{
+			buffer.resize(Utf8::maxDecodedSize(n) + 1);
+			return TSTRVIEW<wchar_t>(&buffer[0], Utf8::decode(s, n, &buffer[0]).written);
+		}
+
+		static inline size_t capacity(size_t n)
+		{
+			return Utf8::maxDecodedSize(n);
+		}
+
+		static inline size_t copy(const char* s, size_t n, wchar_t* out)
+		{
+			return Utf8::decode(s, n, out).written;
+		}
+	};
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface of NulReader<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+	/**
+		Arguments read from a file descriptor as records terminated by a
+		zero, as written by find -print0 (UTF-8 for wchar_t). The records
+		are read one at a time through a buffer of fixed size, which only
+		grows to hold a record larger than itself, so that the input is
+		never held in memory at once. Give the reader to values() to
+		stream the positional values into their container.
+	*/
+	template<typename CHARTYPE>
+	class NulReader
+	{
+	public:
+		inline explicit NulReader(int fd, size_t bufferSize = 64 * 1024);
+		NulReader(const NulReader&) = delete;
+		NulReader& operator=(const NulReader&) = delete;
+
+		/**
+			Read the next record, which stays valid until the next call. The
+			last record may lack its terminating zero.
+
+			@return false at the end of the input or on a read error.
+		*/
+		inline bool next(TSTRVIEW<CHARTYPE>& record);
+
+		/**
+			errno of the read which failed, 0 if none.
+		*/
+		inline int error() const;
+
+		/**
+			Number of records read so far.
+		*/
+		inline size_t count() const;
+	private:
+		inline bool fill();
+
+		int fd_;
+		std::vector<char> buffer_;
+		size_t begin_;   // First byte not returned yet
+		size_t scanned_; // No zero between begin_ and this one
+		size_t end_;     // End of the bytes read
+		bool eof_;
+		int error_;
+		size_t count_;
+		std::vector<CHARTYPE> text_; // wchar_t only: the record decoded
+	};
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Implementation of NulReader<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template<typename CHARTYPE>
+	inline NulReader<CHARTYPE>::NulReader(int fd, size_t bufferSize)
+		: fd_(fd),
+		buffer_(bufferSize > 0 ? bufferSize : 1),
+		begin_(0),
+		scanned_(0),
+		end_(0),
+		eof_(false),
+		error_(0),
+		count_(0)
+	{
+	}
+
+	template<typename CHARTYPE>
+	inline bool
+	NulReader<CHARTYPE>::next(TSTRVIEW<CHARTYPE>& record)
+	{
+		for (;;)
+		{
+			// data() + i rather than &buffer_[i]: i may be the end of the buffer
+			const char* zero = static_cast<const char*>(
+				std::memchr(buffer_.data() + scanned_, 0, end_ - scanned_));
+			size_t stop = zero != NULL ? zero - buffer_.data() : end_;
+			if (zero != NULL || (eof_ && begin_ < end_))
+			{
+				record = FileText<CHARTYPE>::view(buffer_.data() + begin_, stop - begin_, text_);
+				begin_ = scanned_ = zero != NULL ? stop + 1 : stop;
+				++count_;
+				return true;
+			}
+			scanned_ = end_;
+			if (eof_ || !fill())
+			{
+				return false;
+			}
+		}
+	}
+
+	template<typename CHARTYPE>
+	inline bool
+	NulReader<CHARTYPE>::fill()
+	{
+		// Move the partial record to the front, or grow the buffer if it
+		// fills it, then read after it.
+		if (begin_ > 0)
+		{
+			std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+			end_ -= begin_;
+			scanned_ -= begin_;
+			begin_ = 0;
+		}
+		else if (end_ == buffer_.size())
+		{
+			buffer_.resize(2 * buffer_.size());
+		}
+		for (;;)
+		{
+#ifdef _WIN32
+			int n = _read(fd_, buffer_.data() + end_, static_cast<unsigned int>(buffer_.size() - end_));
+#else
+			ssize_t n = read(fd_, buffer_.data() + end_, buffer_.size() - end_);
+			if (n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+#endif
+			if (n < 0)
+			{
+				error_ = errno;
+				eof_ = true;
+				return false;
+			}
+			eof_ = n == 0;
+			end_ += static_cast<size_t>(n);
+			return true;
+		}
+	}
+
+	template<typename CHARTYPE>
+	inline int
+	NulReader<CHARTYPE>::error() const
+	{
+		return error_;
+	}
+
+	template<typename CHARTYPE>
+	inline size_t
+	NulReader<CHARTYPE>::count() const
+	{
+		return count_;
+	}
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface of ProcessArguments<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+	/**
+		The arguments of the running process, for code which has no access
+		to the argv of main(), e.g. a shared library reading its options
+		when it is loaded:
+
+			const argstream::ProcessArguments<char>& p = argstream::ProcessArguments<char>::instance();
+			argstream::argstream<char> as(p.argc(), p.argv());
+
+		On Linux /proc/self/cmdline is read once into a single buffer and
+		argv() points into it, one pointer per zero terminated argument
+		(decoded from UTF-8 once for wchar_t). On Windows argv() is the one
+		of the C runtime. The instance is built by the first call, later
+		calls from any thread share it read-only.
+	*/
+	template<typename CHARTYPE>
+	class ProcessArguments
+	{
+	public:
+		static inline const ProcessArguments& instance();
+
+		/**
+			Number of arguments, program name included; 0 if they could not
+			be read.
+		*/
+		inline int argc() const;
+		inline CHARTYPE const* const* argv() const;
+	private:
+		inline ProcessArguments();
+		ProcessArguments(const ProcessArguments&) = delete;
+		ProcessArguments& operator=(const ProcessArguments&) = delete;
+
+		std::vector<char> bytes_;
+		std::vector<CHARTYPE> text_; // wchar_t only: bytes_ decoded
+		std::vector<const CHARTYPE*> argv_; // Followed by NULL like the argv of main()
+	};
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Implementation of ProcessArguments<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template<typename CHARTYPE>
+	inline const ProcessArguments<CHARTYPE>&
+	ProcessArguments<CHARTYPE>::instance()
+	{
+		// Initialized once even if several threads get there together
+		static const ProcessArguments arguments;
+		return arguments;
+	}
+
+#ifdef _WIN32
+	inline char** crtArgv(char*) { return __argv; }
+	inline wchar_t** crtArgv(wchar_t*) { return __wargv; }
+
+	template<typename CHARTYPE>
+	inline ProcessArguments<CHARTYPE>::ProcessArguments()
+	{
+		// __argv or __wargv is NULL when main() has the other character type
+		CHARTYPE** argv = crtArgv(static_cast<CHARTYPE*>(NULL));
+		if (argv != NULL)
+		{
+			argv_.assign(argv, argv + __argc);
+		}
+		argv_.push_back(NULL);
+	}
+#else
+	template<typename CHARTYPE>
+	inline ProcessArguments<CHARTYPE>::ProcessArguments()
+	{
+		// procfs reports a size of 0 and cannot be mapped, the file is read
+		// into a buffer doubled until it holds all of it.
+		int fd = ::open("/proc/self/cmdline", O_RDONLY | O_CLOEXEC);
+		if (fd >= 0)
+		{
+			size_t size = 0;
+			bytes_.resize(4096);
+			for (;;)
+			{
+				ssize_t n = read(fd, &bytes_[size], bytes_.size() - size);
+				if (n < 0 && errno == EINTR)
+				{
+					continue;
+				}
+				if (n <= 0)
+				{
+					break;
+				}
+				size += static_cast<size_t>(n);
+				if (size == bytes_.size())
+				{
+					bytes_.resize(2 * size);
+				}
+			}
+			::close(fd);
+			bytes_.resize(size);
+			if (size > 0 && bytes_.back() != 0)
+			{
+				// A process may overwrite its arguments, the last one keeps
+				// its zero here.
+				bytes_.push_back(0);
+			}
+		}
+		if (!bytes_.empty())
+		{
+			TSTRVIEW<CHARTYPE> all = FileText<CHARTYPE>::view(&bytes_[0], bytes_.size(), text_);
+			const CHARTYPE* p = all.data();
+			const CHARTYPE* end = p + all.size();
+			while (p < end)
+			{
+				argv_.push_back(p);
+				p += std::char_traits<CHARTYPE>::length(p) + 1;
+			}
+		}
+		argv_.push_back(NULL);
+	}
+#endif
+
+	template<typename CHARTYPE>
+	inline int
+	ProcessArguments<CHARTYPE>::argc() const
+	{
+		return static_cast<int>(argv_.size() - 1);
+	}
+
+	template<typename CHARTYPE>
+	inline CHARTYPE const* const*
+	ProcessArguments<CHARTYPE>::argv() const
+	{
+		return &argv_[0];
+	}
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface and implementation of Tokenizer<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template<typename CHARTYPE>
+	class Tokenizer
+	{
+	public:
+		/**
+			Split a command line into an argv array.
+
+			The command line is copied once into buffer and unescaped in
+			place: quotes and escapes are removed, the arguments are
+			terminated by zeros and argv points into buffer. Both vectors are
+			overwritten, so that they can be reused for many command lines
+			without allocating again.
+
+			With SPLIT_POSIX, arguments are separated by white spaces,
+			characters between single quotes are kept as is, a backslash
+			escapes the next character, and between double quotes it only
+			escapes $ ` " \ and new line. With SPLIT_WINDOWS, the rules of
+			CommandLineToArgvW apply: the program name ends at the first
+			space or tab, or at the closing quote, and in the arguments 2n
+			backslashes followed by a quote give n backslashes, 2n+1 give n
+			backslashes and a literal quote. Unterminated quotes end with the
+			command line.
+
+			@param c The command line.
+			@param buffer Receives the characters of the arguments.
+			@param argv Receives the arguments, there is always at least one
+			       element since the first one is the program name.
+			@param mode The quoting rules.
+		*/
+		template<typename BUFFER, typename ARGV>
+		static inline void split(
+			const CHARTYPE* c,
+			BUFFER& buffer,
+			ARGV& argv,
+			SPLIT_MODE mode = SPLIT_NATIVE)
+		{
+			size_t len = std::char_traits<CHARTYPE>::length(c);
+			buffer.assign(c, c + len + 1);
+			argv.clear();
+#ifdef _WIN32
+			if (mode == SPLIT_NATIVE) mode = SPLIT_WINDOWS;
+#endif
+			if (mode == SPLIT_WINDOWS)
+			{
+				splitWindows(&buffer[0], &buffer[len], argv);
+			}
+			else
+			{
+				splitPosix(&buffer[0], &buffer[len], argv);
+			}
+			if (argv.empty())
+			{
+				argv.push_back(&buffer[len]);
+			}
+		}
+
+		/**
+			Split the arguments of a response file in place, with the same
+			rules as split() but without a program name. With SPLIT_WINDOWS
+			the new lines separate arguments too.
+
+			@param p The text, modified.
+			@param end The zero terminating the text.
+			@param argv Receives the arguments, pointing into the text.
+			@param mode The quoting rules.
+		*/
+		template<typename ARGV>
+		static inline void splitArguments(
+			CHARTYPE* p,
+			const CHARTYPE* end,
+			ARGV& argv,
+			SPLIT_MODE mode = SPLIT_NATIVE)
+		{
+#ifdef _WIN32
+			if (mode == SPLIT_NATIVE) mode = SPLIT_WINDOWS;
+#endif
+			if (mode == SPLIT_WINDOWS)
+			{
+				splitWindowsArguments(p, p, end, argv, &isSpace);
+			}
+			else
+			{
+				splitPosix(p, end, argv);
+			}
+		}
+	private:
+		static inline bool isSpace(CHARTYPE c)
+		{
+			return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+		}
+
+		static inline bool isBlank(CHARTYPE c)
+		{
+			return c == ' ' || c == '\t';
+		}
+
+		/**
+			Copy the run of characters from r which need no unescaping.
+
+			@return false if r is on a stop character of Scanner.
+		*/
+		static inline bool copyPlain(CHARTYPE*& r, CHARTYPE*& w, const CHARTYPE* end)
+		{
+			size_t n = Scanner<CHARTYPE>::find(r, end) - r;
+			if (n == 0)
+			{
+				return false;
+			}
+			if (w != r)
+			{
+				std::memmove(w, r, n * sizeof(CHARTYPE));
+			}
+			r += n;
+			w += n;
+			return true;
+		}
+
+		/**
+			Terminate the argument written up to w, and move r past the
+			separator if it was overwritten. The writer never gets ahead of
+			the reader, so that unescaping in place is safe.
+
+			@return false at the end of the command line.
+		*/
+		static inline bool endArgument(CHARTYPE*& r, CHARTYPE*& w)
+		{
+			bool more = *r != 0;
+			*w++ = 0;
+			if (r < w) r = w;
+			return more;
+		}
+
+		template<typename ARGV>
+		static inline void splitPosix(CHARTYPE* p, const CHARTYPE* end, ARGV& argv)
+		{
+			CHARTYPE* r = p;
+			CHARTYPE* w = p;
+			for (;;)
+			{
+				while (isSpace(*r) || (*r == '\\' && r[1] == '\n'))
+				{
+					r += *r == '\\' ? 2 : 1;
+				}
+				if (*r == 0)
+				{
+					break;
+				}
+				argv.push_back(w);
+				while (*r != 0 && !isSpace(*r))
+				{
+					if (copyPlain(r, w, end))
+					{
+						continue;
+					}
+					CHARTYPE ch = *r++;
+					if (ch == '\\')
+					{
+						if (*r == '\n') ++r;
+						else if (*r != 0) *w++ = *r++;
+						else *w++ = ch;
+					}
+					else if (ch == '\'')
+					{
+						while (*r != 0 && *r != '\'')
+						{
+							if (!copyPlain(r, w, end)) *w++ = *r++;
+						}
+						if (*r != 0) ++r;
+					}
+					else if (ch == '"')
+					{
+						while (*r != 0 && *r != '"')
+						{
+							if (copyPlain(r, w, end))
+							{
+								continue;
+							}
+							if (*r == '\\' && (r[1] == '$' || r[1] == '`' || r[1] == '"' || r[1] == '\\' || r[1] == '\n'))
+							{
+								++r;
+								if (*r == '\n')
+								{
+									++r;
+									continue;
+								}
+							}
+							*w++ = *r++;
+						}
+						if (*r != 0) ++r;
+					}
+					else
+					{
+						*w++ = ch;
+					}
+				}
+				if (!endArgument(r, w))
+				{
+					break;
+				}
+			}
+		}
+
+		template<typename ARGV>
+		static inline void splitWindows(CHARTYPE* p, const CHARTYPE* end, ARGV& argv)
+		{
+			CHARTYPE* r = p;
+			CHARTYPE* w = p;
+			while (isBlank(*r))
+			{
+				++r;
+			}
+			if (*r == 0)
+			{
+				return;
+			}
+			// The program name has no escapes
+			argv.push_back(w);
+			if (*r == '"')
+			{
+				++r;
+				while (*r != 0 && *r != '"') *w++ = *r++;
+				if (*r != 0) ++r;
+			}
+			else
+			{
+				while (*r != 0 && !isBlank(*r)) *w++ = *r++;
+			}
+			if (!endArgument(r, w))
+			{
+				return;
+			}
+			splitWindowsArguments(r, w, end, argv, &isBlank);
+		}
+
+		/**
+			The arguments after the program name, separated by the
+			characters for which separator is true.
+		*/
+		template<typename ARGV>
+		static inline void splitWindowsArguments(
+			CHARTYPE* r,
+			CHARTYPE* w,
+			const CHARTYPE* end,
+			ARGV& argv,
+			bool (*separator)(CHARTYPE))
+		{
+			for (;;)
+			{
+				while (separator(*r))
+				{
+					++r;
+				}
+				if (*r == 0)
+				{
+					break;
+				}
+				argv.push_back(w);
+				size_t backslashes = 0;
+				int quotes = 0; // Odd inside quotes
+				while (*r != 0 && (quotes != 0 || !separator(*r)))
+				{
+					if (copyPlain(r, w, end))
+					{
+						backslashes = 0;
+						continue;
+					}
+					CHARTYPE ch = *r++;
+					if (ch == '\\')
+					{
+						*w++ = ch;
+						++backslashes;
+					}
+					else if (ch == '"')
+					{
+						w -= backslashes / 2;
+						if (backslashes % 2 == 0)
+						{
+							++quotes;
+						}
+						else
+						{
+							w[-1] = '"';
+						}
+						backslashes = 0;
+						// In a run of quotes, every third one is literal
+						while (*r == '"')
+						{
+							++r;
+							if (++quotes == 3)
+							{
+								*w++ = '"';
+								quotes = 0;
+							}
+						}
+						if (quotes == 2) quotes = 0;
+					}
+					else
+					{
+						*w++ = ch;
+						backslashes = 0;
+					}
+				}
+				if (!endArgument(r, w))
+				{
+					break;
+				}
+			}
+		}
+	};
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface of argstream<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template<typename CHARTYPE>
+	class argstream
+	{
+	public:
+		ARGSTREAM_INLINE argstream<CHARTYPE>(int argc,CHARTYPE const* const argv[]);
+
+		/**
+			Split the command line c with the quoting rules of mode, see
+			Tokenizer::split().
+		*/
+		ARGSTREAM_INLINE argstream<CHARTYPE>(const CHARTYPE* c, SPLIT_MODE mode = SPLIT_NATIVE);
+
+		/**
+			Take all the memory of the parser from resource r, for instance
+			a monotonic_buffer_resource released once the parser is gone.
+		*/
+		ARGSTREAM_INLINE argstream<CHARTYPE>(int argc,CHARTYPE const* const argv[], memory_resource* r);
+		ARGSTREAM_INLINE argstream<CHARTYPE>(const CHARTYPE* c, memory_resource* r, SPLIT_MODE mode = SPLIT_NATIVE);
+
+		/**
+			Replace the arguments @file by the arguments held by the file,
+			split with the quoting rules of mode. The file is mapped in
+			memory and split in place, the tokens refer to the mapping.
+			The arguments of a file have the position of the @file in argv.
+			A file which cannot be read, or which includes itself, is an
+			error. Arguments after -- are not expanded.
+		*/
+		ARGSTREAM_INLINE argstream<CHARTYPE>(int argc,CHARTYPE const* const argv[], RESPONSE_FILE_MODE files,
+			memory_resource* r = new_delete_resource(), SPLIT_MODE mode = SPLIT_NATIVE);
+
+		/**
+			Add the settings of the configuration file path below those of
+			the command line, before binding any holder. Each line is
+			"name = value", or "name" alone for an option(), where name is
+			the long name of the holder; blank lines and lines starting
+			with # or ; are skipped. The file is mapped in memory and read
+			in a single scan into the tokens, which refer to the mapping. A
+			holder given on the command line, by its short or long name,
+			takes the value of the command line and the setting is consumed;
+			the settings never become positional values. An option() is set
+			by a setting unless its value is 0, false, no or off. A file
+			given by a later call overrides the previous ones. Settings no
+			holder declares are ignored, so that a file can be shared with
+			other tools; a line without name is reported as path:line.
+
+			@return false if the file cannot be read, or if a holder is
+			        already bound.
+		*/
+		ARGSTREAM_INLINE bool config(const CHARTYPE* path);
+
+		// Tokens refer to argv or to buffer_, copying would leave them dangling.
+		argstream<CHARTYPE>(const argstream<CHARTYPE>&) = delete;
+		argstream<CHARTYPE>& operator=(const argstream<CHARTYPE>&) = delete;
+
+		template<typename C, typename T>
+		friend argstream<C>& operator>>(
+			argstream<C>& s,
+			ValueHolder<C, T> const& v);
+	
+		template<typename C>
+		friend argstream<C>& operator>>(
+			argstream<C>& s,
+			OptionHolder<C> const& v);
+		template<typename C, typename T, typename O>
+		friend argstream<C>& operator>>(
+			argstream<C>& s,
+			ValuesHolder<C, T, O> const& v);
+		
+		template<typename C>
+		friend argstream<C>& operator>>(
+			argstream<C>& s,
+			ExampleHolder<C> const& v);
+
+		template<typename C>
+		friend argstream<C>& operator>>(
+			argstream<C>& s,
+			CopyrightHolder<C> const& v);
+
+		/**
+			Bind all the holders at once, with the same result as chaining
+			them with operator>> in the same order. The holders are collected
+			first, then the tokens are matched against their names in a single
+			pass, so the cost is linear in the number of tokens and holders.
+		*/
+		template<typename... HOLDERS>
+		inline argstream<CHARTYPE>& bind(const HOLDERS&... holders);
+
+		inline bool helpRequested() const;
+		inline bool isOk() const;
+		ARGSTREAM_INLINE typename TSTR<CHARTYPE>::type errorLog() const;
+
+		/**
+			The text of the usage, formatted by the first call and kept
+			until a holder is declared. Although const, the usage() calls
+			fill this cache and must not be made from several threads at
+			the same time.
+		*/
+		ARGSTREAM_INLINE typename TSTR<CHARTYPE>::type usage() const;
+
+		/**
+			Write the errors or the usage to a stream, without building the
+			whole text first.
+		*/
+		ARGSTREAM_INLINE typename TSTRSTREAM<CHARTYPE>::COUT& errorLog(typename TSTRSTREAM<CHARTYPE>::COUT& os) const;
+		ARGSTREAM_INLINE typename TSTRSTREAM<CHARTYPE>::COUT& usage(typename TSTRSTREAM<CHARTYPE>::COUT& os) const;
+
+		/**
+			Write the errors or the usage to a file descriptor with gathered
+			writes, in UTF-8 for wchar_t. Return false if a write failed.
+		*/
+		ARGSTREAM_INLINE bool errorLog(int fd) const;
+		ARGSTREAM_INLINE bool usage(int fd) const;
+		ARGSTREAM_INLINE RESULT_OF_PARSE defaultErrorHandling(bool ignoreUnused=false) const;
+
+		/**
+			An error met while parsing or binding. Only the code and the
+			indexes are stored, the text is formatted by errorLog() or
+			errorMessage() when asked for.
+		*/
+		struct error_record
+		{
+			ERROR_CODE code;
+			size_t position;  // Index in argv of the argument at fault, 0 if none or in a configuration file
+			size_t token;     // Index of the token at fault, npos if none
+			size_t holder;    // Index of the holder in the order of declaration, npos if none
+			TSTRVIEW<CHARTYPE> argument; // Text at fault, refers to the command line
+		};
+		typedef std::vector<error_record, resource_allocator<error_record> > error_vector;
+
+		inline const error_vector& errors() const;
+		ARGSTREAM_INLINE typename TSTR<CHARTYPE>::type errorMessage(const error_record& e) const;
+
+		/**
+			Record an ERR_UNUSED error for each argument left unconsumed by
+			the holders and return their number. isOk() is not changed. The
+			settings of config() are never reported.
+		*/
+		ARGSTREAM_INLINE size_t reportUnused();
+
+		/**
+			Positions in argv of the arguments left unconsumed by the
+			holders, in increasing order. A group of switches such as -abc
+			is reported once if any of them is unused.
+		*/
+		ARGSTREAM_INLINE std::vector<size_t> unusedPositions() const;
+	protected:
+		void parse(int argc, CHARTYPE const* const argv[]);
+	private:
+		typedef std::basic_string<CHARTYPE, std::char_traits<CHARTYPE>, resource_allocator<CHARTYPE> > string_type;
+		typedef typename std::pair<TSTRVIEW<CHARTYPE>, TSTRVIEW<CHARTYPE> > example_entry;
+
+		/**
+			What usage() shows of a holder. The texts refer to the strings
+			given to parameter(), option()... and are only formatted when
+			usage() is first called.
+		*/
+		struct help_record
+		{
+			HELP_KIND kind;
+			bool mandatory;
+			CHARTYPE shortName; // 0 if none
+			TSTRVIEW<CHARTYPE> longName;
+			TSTRVIEW<CHARTYPE> description;
+			int len;            // values(): number of values expected
+			CHARTYPE letter;    // values(): letter shown in the usage
+			TSTRVIEW<CHARTYPE> env; // Environment variable of the holder, empty if none
+		};
+
+		/**
+			One record of the token table. An option is linked to the value
+			immediately following it on the command line, if any. The text
+			refers to argv, or to buffer_ when parsing a command line string,
+			or to a file; it is never copied. The settings of config() come
+			first, with position 0. Whether a holder took the token is kept
+			aside in consumed_.
+		*/
+		struct token
+		{
+			TOKEN_KIND kind;
+			size_t position; // Index of the argument in argv, 0 for a setting
+			size_t value;    // Index of the linked value token, npos if none
+			TSTRVIEW<CHARTYPE> text;
+		};
+		static const size_t npos = static_cast<size_t>(-1);
+		typedef std::vector<token, resource_allocator<token> > token_vector;
+
+		ARGSTREAM_INLINE bool addArgument(const TSTRVIEW<CHARTYPE>& s, size_t position, size_t& lastOption, size_t file);
+		ARGSTREAM_INLINE bool expandResponseFile(const TSTRVIEW<CHARTYPE>& s, size_t position, size_t& lastOption, size_t parent);
+		ARGSTREAM_INLINE bool addSetting(CHARTYPE* line, CHARTYPE* end, token_vector& settings);
+		inline size_t addToken(TOKEN_KIND kind, size_t position, const TSTRVIEW<CHARTYPE>& text);
+		ARGSTREAM_INLINE void indexOptions();
+		ARGSTREAM_INLINE size_t findOption(const TSTRVIEW<CHARTYPE>& name, bool settings = true) const;
+		ARGSTREAM_INLINE size_t findHolderOption(const TSTRVIEW<CHARTYPE>& shortName, const TSTRVIEW<CHARTYPE>& longName);
+		ARGSTREAM_INLINE size_t chooseOption(size_t shortOption, size_t longOption);
+		inline bool isSetting(size_t t) const;
+		inline void consumeSetting(size_t t);
+		inline size_t valueOf(size_t option) const;
+		inline bool isConsumed(size_t t) const;
+		inline void consume(size_t t);
+		ARGSTREAM_INLINE size_t nextUnused(size_t t) const;
+
+		/**
+			A response file expanded by parse(), or a file given to config().
+			For wchar_t the tokens refer to text, the file decoded from UTF-8,
+			for char to the mapping.
+		*/
+		struct response_file
+		{
+			inline explicit response_file(memory_resource* r) : file(r), text(r) {}
+			MappedFile file;
+			std::vector<CHARTYPE, resource_allocator<CHARTYPE> > text;
+			size_t parent; // Index of the file including this one, npos if none
+		};
+
+		/**
+			A holder collected by bind(). found holds the last occurrence of
+			its short and long name on the command line, next the following
+			binding with the same name, both npos if none.
+		*/
+		struct binding
+		{
+			const void* holder;
+			void (*apply)(argstream<CHARTYPE>& s, const void* holder, size_t option, size_t help);
+			size_t help;    // Index of the holder in helps_
+			TSTRVIEW<CHARTYPE> names[2];
+			size_t found[2];
+			size_t next[2];
+			bool checksHelp;
+		};
+		static constexpr size_t bindingTableSize(size_t n, size_t size = 8)
+		{
+			return size >= 4 * n ? size : bindingTableSize(n, 2 * size);
+		}
+
+		template<typename T>
+		inline void collect(binding& b, const ValueHolder<CHARTYPE, T>& v);
+		ARGSTREAM_INLINE void collect(binding& b, const OptionHolder<CHARTYPE>& v);
+		template<typename T, typename O>
+		inline void collect(binding& b, const ValuesHolder<CHARTYPE, T, O>& v);
+		ARGSTREAM_INLINE void collect(binding& b, const ExampleHolder<CHARTYPE>& v);
+		ARGSTREAM_INLINE void collect(binding& b, const CopyrightHolder<CHARTYPE>& v);
+		template<typename HOLDER>
+		static inline void apply(argstream<CHARTYPE>& s, const void* holder, size_t option, size_t help);
+		ARGSTREAM_INLINE void resolve(binding* bindings, size_t n, size_t* table, size_t size);
+
+		template<typename T>
+		inline void declareHolder(const ValueHolder<CHARTYPE, T>& v);
+		ARGSTREAM_INLINE void declareHolder(const OptionHolder<CHARTYPE>& v);
+		template<typename T>
+		inline void bindHolder(const ValueHolder<CHARTYPE, T>& v, size_t option, size_t help);
+		ARGSTREAM_INLINE void bindHolder(const OptionHolder<CHARTYPE>& v, size_t option, size_t help);
+		template<typename T, typename O>
+		inline void declareHolder(const ValuesHolder<CHARTYPE, T, O>& v);
+		template<typename T, typename O>
+		inline void bindHolder(const ValuesHolder<CHARTYPE, T, O>& v, size_t option, size_t help);
+		ARGSTREAM_INLINE void checkHelp();
+
+		inline size_t takeValue();
+		template<typename T, typename O>
+		inline size_t storeValues(O& o, size_t limit, size_t help, NulReader<CHARTYPE>* source);
+		template<typename T, typename A>
+		inline size_t storeValues(std::vector<T, A>*& v, size_t limit, size_t help, NulReader<CHARTYPE>* source);
+		ARGSTREAM_INLINE void addStreamError(const TSTRVIEW<CHARTYPE>& record, size_t help);
+		ARGSTREAM_INLINE const TSTRVIEW<CHARTYPE>* findEnvironment(const TSTRVIEW<CHARTYPE>& name);
+		ARGSTREAM_INLINE void indexEnvironment();
+		static inline bool isSet(const TSTRVIEW<CHARTYPE>& value);
+		ARGSTREAM_INLINE void checkStream(const NulReader<CHARTYPE>& source, size_t help);
+
+		inline bool hasUnused() const;
+		ARGSTREAM_INLINE void addError(ERROR_CODE code, size_t position, size_t tokenIndex, size_t help,
+			const TSTRVIEW<CHARTYPE>& argument);
+		ARGSTREAM_INLINE void addError(ERROR_CODE code, size_t tokenIndex, size_t help);
+		ARGSTREAM_INLINE void addHelp(HELP_KIND kind, bool mandatory, const typename TSTR<CHARTYPE>::type& shortName,
+			const TSTRVIEW<CHARTYPE>& longName, const TSTRVIEW<CHARTYPE>& description);
+		template<typename SINK>
+		inline void writeUsage(SINK& out) const;
+		template<typename SINK>
+		inline void writeErrors(SINK& out) const;
+		template<typename SINK>
+		inline void writeError(SINK& out, const error_record& e) const;
+		template<typename SINK>
+		inline void writeName(SINK& out, const help_record& h) const;
+		inline size_t nameSize(const help_record& h) const;
+
+		memory_resource* resource_;
+		string_type progName_;
+		TSTRVIEW<CHARTYPE> copyright_;
+		token_vector tokens_;
+		size_t settings_; // The tokens of config() come first, before those of the command line
+		std::vector<unsigned long long, resource_allocator<unsigned long long> > consumed_; // One bit per token
+		std::vector<size_t, resource_allocator<size_t> > options_; // Option tokens sorted by name, one per name
+		bool minusActive_;
+		bool isOk_;
+		std::vector<CHARTYPE, resource_allocator<CHARTYPE> > buffer_; // Arguments split from a command line string
+		std::vector<const CHARTYPE*, resource_allocator<const CHARTYPE*> > argv_from_cmdline_;
+		std::vector<help_record, resource_allocator<help_record> > helps_;
+		std::vector<example_entry, resource_allocator<example_entry> > examples_;
+		mutable string_type usage_;  // Formatted by the first usage()
+		mutable bool usageValid_;
+		error_vector errors_;
+		bool helpRequested_;
+		size_t valueCursor_;    // No positional value left before this token
+		CHARTYPE valuesLetter_; // Letter of the next values() in usage()
+		RESPONSE_FILE_MODE responseMode_;
+		SPLIT_MODE responseSplit_;
+		std::deque<response_file, resource_allocator<response_file> > responseFiles_; // Never moved, the tokens refer to them
+		std::deque<string_type, resource_allocator<string_type> > streamed_; // Texts of errors which outlive their source
+
+		/**
+			A variable of environ, in the hash table built by
+			indexEnvironment() the first time a holder needs it.
+		*/
+		struct environment_entry
+		{
+			TSTRVIEW<CHARTYPE> name; // Empty for a free bucket
+			TSTRVIEW<CHARTYPE> value;
+		};
+		std::vector<CHARTYPE, resource_allocator<CHARTYPE> > environmentText_; // environ copied, decoded for wchar_t
+		std::vector<environment_entry, resource_allocator<environment_entry> > environment_;
+		bool environmentIndexed_;
+	};
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Implementation of argstream<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE argstream<CHARTYPE>::argstream(int argc, CHARTYPE const* const argv[])
+		: argstream<CHARTYPE>(argc, argv, new_delete_resource())
+	{
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE argstream<CHARTYPE>::argstream(const CHARTYPE* c, SPLIT_MODE mode)
+		: argstream<CHARTYPE>(c, new_delete_resource(), mode)
+	{
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE argstream<CHARTYPE>::argstream(int argc, CHARTYPE const* const argv[], memory_resource* r)
+		: argstream<CHARTYPE>(argc, argv, RESPONSE_FILE_NONE, r)
+	{
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE argstream<CHARTYPE>::argstream(int argc, CHARTYPE const* const argv[],
+		RESPONSE_FILE_MODE files, memory_resource* r, SPLIT_MODE mode)
+		: resource_(r),
+		progName_(r),
+		tokens_(r),
+		settings_(0),
+		consumed_(r),
+		options_(r),
+		minusActive_(true),
+		isOk_(true),
+		buffer_(r),
+		argv_from_cmdline_(r),
+		helps_(r),
+		examples_(r),
+		usage_(r),
+		usageValid_(false),
+		errors_(r),
+		helpRequested_(false),
+		valueCursor_(0),
+		valuesLetter_('a'),
+		responseMode_(files),
+		responseSplit_(mode),
+		responseFiles_(r),
+		streamed_(r),
+		environmentText_(r),
+		environment_(r),
+		environmentIndexed_(false)
+	{
+		ARGSTREAM_PHASE(CHARTYPE, PHASE_TOKENIZE, r, TSTRVIEW<CHARTYPE>());
+		TSTRVIEW<CHARTYPE> argv0(argv[0]);
+		size_t found = argv0.size();
+		while (found > 0 && argv0[found - 1] != '/' && argv0[found - 1] != '\\')
+		{
+			--found;
+		}
+		progName_.assign(argv0.data() + found, argv0.size() - found);
+		parse(argc,argv);
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE argstream<CHARTYPE>::argstream(const CHARTYPE* c, memory_resource* r, SPLIT_MODE mode)
+		: resource_(r),
+		progName_(r),
+		tokens_(r),
+		settings_(0),
+		consumed_(r),
+		options_(r),
+		minusActive_(true),
+		isOk_(true),
+		buffer_(r),
+		argv_from_cmdline_(r),
+		helps_(r),
+		examples_(r),
+		usage_(r),
+		usageValid_(false),
+		errors_(r),
+		helpRequested_(false),
+		valueCursor_(0),
+		valuesLetter_('a'),
+		responseMode_(RESPONSE_FILE_NONE),
+		responseSplit_(mode),
+		responseFiles_(r),
+		streamed_(r),
+		environmentText_(r),
+		environment_(r),
+		environmentIndexed_(false)
+	{
+		ARGSTREAM_PHASE(CHARTYPE, PHASE_TOKENIZE, r, TSTRVIEW<CHARTYPE>());
+		Tokenizer<CHARTYPE>::split(c, buffer_, argv_from_cmdline_, mode);
+		parse(static_cast<int>(argv_from_cmdline_.size()), &argv_from_cmdline_[0]);
+	}
+
+	template<typename CHARTYPE>
+	const size_t argstream<CHARTYPE>::npos;
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE void argstream<CHARTYPE>::parse(int argc, CHARTYPE const* const argv[])
+	{
+		// Run thru all arguments.
+		// * it has -- in front : it is a long name option, if remainder is empty,
+		//                        it is an error
+		// * it has - in front  : it is a sequence of short name options, if
+		//                        remainder is empty, deactivates option (- will
+		//                        now be considered a _TCHAR).
+		// * if any other _TCHAR, or if option was deactivated
+		//                      : it is a value. Values are split in parameters
+		//                      (immediately follow an option) and pure values.
+		// Each time a value is parsed, if the previously parsed argument was an
+		// option, then the option is linked to the value in case of it is a
+		// option with parameter.  The subtle point is that when several options
+		// are given with short names (ex: -abc equivalent to -a -b -c), the last
+		// parsed option is -c).
+		// Only the last occurrence of an option is kept (see indexOptions()):
+		// foo -a -b -a hello is equivalent to foo -b -a hello
+		// For values it is not true since we might have several times the same
+		// value.
+		tokens_.reserve(argc);
+		size_t lastOption = npos;
+		for (int i = 1; i < argc; ++i)
+		{
+			if (!addArgument(argv[i], i, lastOption, npos))
+			{
+				break;
+			}
+		}
+		consumed_.assign((tokens_.size() + 63) / 64, 0);
+		indexOptions();
+#ifdef ARGSTREAM_DEBUG
+		for (typename token_vector::const_iterator
+			iter = tokens_.begin();iter != tokens_.end();++iter)
+		{
+			if (iter->kind == TOKEN_OPTION)
+			{
+				debugStream(CHARTYPE()) << ARGSTREAM_LITERAL(CHARTYPE, "DEBUG: option ") << iter->text;
+				if (iter->value != npos)
+				{
+					debugStream(CHARTYPE()) << ARGSTREAM_LITERAL(CHARTYPE, " -> ") << tokens_[iter->value].text;
+				}
+			}
+			else
+			{
+				debugStream(CHARTYPE()) << ARGSTREAM_LITERAL(CHARTYPE, "DEBUG: value ") << iter->text;
+			}
+			debugStream(CHARTYPE())<<std::endl;
+		}
+#endif // ARGSTREAM_DEBUG
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE bool
+	argstream<CHARTYPE>::addArgument(
+		const TSTRVIEW<CHARTYPE>& s,
+		size_t position,
+		size_t& lastOption,
+		size_t file)
+	{
+		// Tokenize one argument of argv or of the response file file. Return
+		// false when the rest of the command line must be ignored.
+		if (minusActive_ && !s.empty() && s[0] == '-')
+		{
+			if (s.size() > 1 && s[1] == '-')
+			{
+				if (s.size() == 2)
+				{
+					minusActive_ = false;
+					return true;
+				}
+				lastOption = addToken(TOKEN_OPTION, position, s.substr(2));
+			}
+			else
+			{
+				if (s.size() > 1)
+				{
+					// Parse all _TCHARs, if it is a minus we have an error
+					for (typename TSTRVIEW<CHARTYPE>::const_iterator cter = s.begin();
+						++cter != s.end();)
+					{
+						if (*cter == '-')
+						{
+							isOk_ = false;
+							addError(ERR_MINUS_IN_SWITCH, position, npos, npos, s);
+							break;
+						}
+						lastOption = addToken(TOKEN_OPTION, position, TSTRVIEW<CHARTYPE>(cter, 1));
+					}
+				}
+				else
+				{
+					isOk_ = false;
+					addError(ERR_LONE_MINUS, position, npos, npos, s);
+					return false;
+				}
+			}
+		}
+		else if (minusActive_ && s.size() > 1 && s[0] == '@' &&
+			(responseMode_ == RESPONSE_FILE_RECURSIVE || (responseMode_ == RESPONSE_FILE_EXPAND && file == npos)))
+		{
+			return expandResponseFile(s, position, lastOption, file);
+		}
+		else
+		{
+			size_t value = addToken(TOKEN_VALUE, position, s);
+			if (lastOption != npos)
+			{
+				tokens_[lastOption].value = value;
+			}
+			lastOption = npos;
+		}
+		return true;
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE bool
+	argstream<CHARTYPE>::expandResponseFile(
+		const TSTRVIEW<CHARTYPE>& s,
+		size_t position,
+		size_t& lastOption,
+		size_t parent)
+	{
+		TSTRVIEW<CHARTYPE> path = s.substr(1);
+		responseFiles_.emplace_back(resource_);
+		response_file& f = responseFiles_.back();
+		f.parent = parent;
+		if (!f.file.open(TSTR<char>::ToString(path.data()).c_str()))
+		{
+			responseFiles_.pop_back();
+			isOk_ = false;
+			addError(ERR_RESPONSE_FILE, position, npos, npos, path);
+			return true;
+		}
+		for (size_t p = parent; p != npos; p = responseFiles_[p].parent)
+		{
+			if (responseFiles_[p].file.sameFile(f.file))
+			{
+				responseFiles_.pop_back();
+				isOk_ = false;
+				addError(ERR_RESPONSE_FILE_CYCLE, position, npos, npos, path);
+				return true;
+			}
+		}
+		size_t size = 0;
+		CHARTYPE* text = FileText<CHARTYPE>::load(f.file, f.text, size);
+		size_t file = responseFiles_.size() - 1;
+
+		// The arguments only live until they are tokenized, the tokens refer
+		// to the text.
+		std::vector<const CHARTYPE*, resource_allocator<const CHARTYPE*> > argv(resource_);
+		Tokenizer<CHARTYPE>::splitArguments(text, text + size, argv, responseSplit_);
+		tokens_.reserve(tokens_.size() + argv.size());
+		for (size_t i = 0; i < argv.size(); ++i)
+		{
+			if (!addArgument(argv[i], position, lastOption, file))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE bool
+	argstream<CHARTYPE>::config(const CHARTYPE* path)
+	{
+		ARGSTREAM_PHASE(CHARTYPE, PHASE_TOKENIZE, resource_, TSTRVIEW<CHARTYPE>(path));
+		// The token indexes change below, the holders must come after.
+		if (!helps_.empty() || valueCursor_ != 0)
+		{
+			return false;
+		}
+		responseFiles_.emplace_back(resource_);
+		response_file& f = responseFiles_.back();
+		f.parent = npos;
+		TSTRVIEW<CHARTYPE> name(path);
+		if (!f.file.open(TSTR<char>::ToString(path).c_str()))
+		{
+			responseFiles_.pop_back();
+			isOk_ = false;
+			streamed_.emplace_back(path, resource_allocator<CHARTYPE>(resource_));
+			addError(ERR_CONFIG_FILE, 0, npos, npos, TSTRVIEW<CHARTYPE>(streamed_.back().data(), streamed_.back().size()));
+			return false;
+		}
+		size_t size = 0;
+		CHARTYPE* text = FileText<CHARTYPE>::load(f.file, f.text, size);
+
+		// One scan over the lines, then the settings go after those of the
+		// previous files and before the tokens of the command line: the last
+		// occurrence of a name is the one indexOptions() keeps.
+		token_vector settings(resource_);
+		settings.assign(tokens_.begin(), tokens_.begin() + settings_);
+		CHARTYPE* end = text + size;
+		size_t number = 1;
+		for (CHARTYPE* line = text; line < end; ++number)
+		{
+			CHARTYPE* eol = std::find(line, end, CHARTYPE('\n'));
+			if (!addSetting(line, eol, settings))
+			{
+				// Reported as path:line: text
+				isOk_ = false;
+				streamed_.emplace_back(resource_allocator<CHARTYPE>(resource_));
+				StringSink<CHARTYPE, string_type> out(streamed_.back());
+				out.put(name);
+				out.put(CHARTYPE(':'));
+				out.number(static_cast<long>(number));
+				out.put(ARGSTREAM_LITERAL(CHARTYPE, ": "));
+				out.put(TSTRVIEW<CHARTYPE>(line, eol - line));
+				addError(ERR_CONFIG_LINE, 0, npos, npos, TSTRVIEW<CHARTYPE>(streamed_.back().data(), streamed_.back().size()));
+			}
+			line = eol + 1;
+		}
+		size_t shift = settings.size() - settings_;
+		settings.reserve(settings.size() + tokens_.size() - settings_);
+		for (size_t i = settings_; i < tokens_.size(); ++i)
+		{
+			token t = tokens_[i];
+			if (t.value != npos)
+			{
+				t.value += shift;
+			}
+			settings.push_back(t);
+		}
+		settings_ += shift;
+		tokens_.swap(settings);
+		for (error_record& e : errors_)
+		{
+			if (e.token != npos)
+			{
+				e.token += shift;
+			}
+		}
+		consumed_.assign((tokens_.size() + 63) / 64, 0);
+		indexOptions();
+		return true;
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE bool
+	argstream<CHARTYPE>::addSetting(CHARTYPE* line, CHARTYPE* end, token_vector& settings)
+	{
+		// "name = value" or "name", spaces around name and value are ignored.
+		// Returns false for a line without name.
+		auto space = [](CHARTYPE c) { return c == ' ' || c == '\t' || c == '\r'; };
+		while (line < end && space(*line))
+		{
+			++line;
+		}
+		if (line == end || *line == '#' || *line == ';')
+		{
+			return true;
+		}
+		CHARTYPE* equal = std::find(line, end, CHARTYPE('='));
+		CHARTYPE* nameEnd = equal;
+		while (nameEnd > line && space(nameEnd[-1]))
+		{
+			--nameEnd;
+		}
+		if (nameEnd == line)
+		{
+			return false;
+		}
+		token t;
+		t.kind = TOKEN_OPTION;
+		t.position = 0;
+		t.value = npos;
+		t.text = TSTRVIEW<CHARTYPE>(line, nameEnd - line);
+		if (equal != end)
+		{
+			CHARTYPE* value = equal + 1;
+			while (value < end && space(*value))
+			{
+				++value;
+			}
+			while (end > value && space(end[-1]))
+			{
+				--end;
+			}
+			t.value = settings.size() + 1;
+			settings.push_back(t);
+			t.kind = TOKEN_SETTING;
+			t.value = npos;
+			t.text = TSTRVIEW<CHARTYPE>(value, end - value);
+		}
+		settings.push_back(t);
+		return true;
+	}
+
+	template<typename CHARTYPE>
+	inline size_t
+	argstream<CHARTYPE>::addToken(
+		TOKEN_KIND kind,
+		size_t position,
+		const TSTRVIEW<CHARTYPE>& text)
+	{
+		token t;
+		t.kind = kind;
+		t.position = position;
+		t.value = npos;
+		t.text = text;
+		tokens_.push_back(t);
+		return tokens_.size() - 1;
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE void
+	argstream<CHARTYPE>::indexOptions()
+	{
+		// Sort the option tokens by name. When an option is given several
+		// times, the last occurrence overrides the previous ones, which are
+		// marked as consumed so that they are not reported as unused.
+		options_.clear();
+		for (size_t i = 0; i < tokens_.size(); ++i)
+		{
+			if (tokens_[i].kind == TOKEN_OPTION)
+			{
+				options_.push_back(i);
+			}
+		}
+		const token_vector& tokens = tokens_;
+		std::stable_sort(options_.begin(), options_.end(),
+			[&tokens](size_t l, size_t r) { return tokens[l].text < tokens[r].text; });
+		size_t n = 0;
+		for (size_t i = 0; i < options_.size(); ++i)
+		{
+			if (i + 1 < options_.size() &&
+				tokens_[options_[i]].text == tokens_[options_[i + 1]].text)
+			{
+				consume(options_[i]);
+				consumeSetting(options_[i]);
+				continue;
+			}
+			options_[n++] = options_[i];
+		}
+		options_.resize(n);
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE size_t
+	argstream<CHARTYPE>::findOption(const TSTRVIEW<CHARTYPE>& name, bool settings) const
+	{
+		// settings is false for short names: the names of a configuration
+		// file are long names only.
+		if (name.empty())
+		{
+			return npos;
+		}
+		const token_vector& tokens = tokens_;
+		typename std::vector<size_t, resource_allocator<size_t> >::const_iterator iter = std::lower_bound(
+			options_.begin(), options_.end(), name,
+			[&tokens](size_t l, const TSTRVIEW<CHARTYPE>& r) { return tokens[l].text < r; });
+		if (iter == options_.end() || tokens_[*iter].text != name || isConsumed(*iter) ||
+			(!settings && isSetting(*iter)))
+		{
+			return npos;
+		}
+		return *iter;
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE size_t
+	argstream<CHARTYPE>::findHolderOption(const TSTRVIEW<CHARTYPE>& shortName, const TSTRVIEW<CHARTYPE>& longName)
+	{
+		return chooseOption(findOption(shortName, false), findOption(longName));
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE size_t
+	argstream<CHARTYPE>::chooseOption(size_t shortOption, size_t longOption)
+	{
+		// The short name comes first. A setting of the long name is then
+		// overridden by the command line and must not be left unused.
+		if (shortOption == npos)
+		{
+			return longOption;
+		}
+		if (longOption != npos && isSetting(longOption))
+		{
+			consume(longOption);
+			consumeSetting(longOption);
+		}
+		return shortOption;
+	}
+
+	template<typename CHARTYPE>
+	inline bool
+	argstream<CHARTYPE>::isSetting(size_t t) const
+	{
+		return t < settings_;
+	}
+
+	template<typename CHARTYPE>
+	inline void
+	argstream<CHARTYPE>::consumeSetting(size_t t)
+	{
+		// The value of a setting belongs to it, unlike a value following
+		// an option on the command line which may be positional.
+		if (isSetting(t) && tokens_[t].value != npos)
+		{
+			consume(tokens_[t].value);
+		}
+	}
+
+	template<typename CHARTYPE>
+	inline size_t
+	argstream<CHARTYPE>::valueOf(size_t option) const
+	{
+		size_t value = tokens_[option].value;
+		if (value == npos || isConsumed(value))
+		{
+			return npos;
+		}
+		return value;
+	}
+
+	template<typename CHARTYPE>
+	inline bool
+	argstream<CHARTYPE>::isConsumed(size_t t) const
+	{
+		return (consumed_[t / 64] >> (t % 64)) & 1;
+	}
+
+	template<typename CHARTYPE>
+	inline void
+	argstream<CHARTYPE>::consume(size_t t)
+	{
+		consumed_[t / 64] |= 1ULL << (t % 64);
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE size_t
+	argstream<CHARTYPE>::nextUnused(size_t t) const
+	{
+		// First unconsumed token from t, npos if none. Fully consumed words
+		// are skipped 64 tokens at a time.
+		while (t < tokens_.size())
+		{
+			unsigned long long unused = ~consumed_[t / 64] >> (t % 64);
+			if (unused == 0)
+			{
+				t = (t / 64 + 1) * 64;
+				continue;
+			}
+			while ((unused & 1) == 0)
+			{
+				unused >>= 1;
+				++t;
+			}
+			return t < tokens_.size() ? t : npos;
+		}
+		return npos;
+	}
+
+	template<typename CHARTYPE>
+	inline bool
+	argstream<CHARTYPE>::hasUnused() const
 	{
+		return nextUnused(settings_) != npos;
 	}
-	template<typename CHARTYPE, typename T>
-	ValueHolder<CHARTYPE, T>::ValueHolder(
-		const CHARTYPE* l,
-		T& v,
-		const CHARTYPE* desc,
-		bool mandatory)
-		:  longName_(l),
-		value_(&v),
-		initialValue_(v),
-		description_(desc),
-		mandatory_(mandatory)
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE void
+	argstream<CHARTYPE>::addError(
+		ERROR_CODE code,
+		size_t position,
+		size_t tokenIndex,
+		size_t help,
+		const TSTRVIEW<CHARTYPE>& argument)
 	{
+		error_record e;
+		e.code = code;
+		e.position = position;
+		e.token = tokenIndex;
+		e.holder = help;
+		e.argument = argument;
+		errors_.push_back(e);
 	}
-	template<typename CHARTYPE, typename T>
-	ValueHolder<CHARTYPE, T>::ValueHolder(CHARTYPE s,
-		T& v,
-		const CHARTYPE* desc,
-		bool mandatory)
-		:  shortName_(1,s),
-		value_(&v),
-		initialValue_(v),
-		description_(desc),
-		mandatory_(mandatory)
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE void
+	argstream<CHARTYPE>::addError(ERROR_CODE code, size_t tokenIndex, size_t help)
 	{
+		if (tokenIndex == npos)
+		{
+			addError(code, 0, npos, help, TSTRVIEW<CHARTYPE>());
+		}
+		else
+		{
+			addError(code, tokens_[tokenIndex].position, tokenIndex, help, tokens_[tokenIndex].text);
+		}
 	}
-	template<typename CHARTYPE, typename T>
-	typename TSTR<CHARTYPE>::type ValueHolder<CHARTYPE, T>::name() const
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE size_t
+	argstream<CHARTYPE>::reportUnused()
 	{
-		typename TSTRSTREAM<CHARTYPE>::O os;
-		if (!shortName_.empty()) os<<'-'<<shortName_;
-		if (!longName_.empty()) {
-			if (!shortName_.empty()) os<<'/';
-			os<<TSTR<CHARTYPE>::ToString("--")<<longName_;
+		size_t n = 0;
+		for (size_t t = nextUnused(settings_); t != npos; t = nextUnused(t + 1))
+		{
+			addError(ERR_UNUSED, t, npos);
+			++n;
 		}
-		return os.str();
+		return n;
 	}
 
-	template<typename CHARTYPE, typename T>
-	inline typename TSTR<CHARTYPE>::type ValueHolder<CHARTYPE, T>::description() const
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE std::vector<size_t>
+	argstream<CHARTYPE>::unusedPositions() const
 	{
-		return description_;
+		std::vector<size_t> positions;
+		for (size_t t = nextUnused(settings_); t != npos; t = nextUnused(t + 1))
+		{
+			if (positions.empty() || positions.back() != tokens_[t].position)
+			{
+				positions.push_back(tokens_[t].position);
+			}
+		}
+		return positions;
 	}
 
+	template<typename CHARTYPE>
+	inline const typename argstream<CHARTYPE>::error_vector&
+	argstream<CHARTYPE>::errors() const
+	{
+		return errors_;
+	}
 
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	// Interface of CopyrightHolder<CHARTYPE>
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	template <typename CHARTYPE>
-	class CopyrightHolder
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE void
+	argstream<CHARTYPE>::addHelp(
+		HELP_KIND kind,
+		bool mandatory,
+		const typename TSTR<CHARTYPE>::type& shortName,
+		const TSTRVIEW<CHARTYPE>& longName,
+		const TSTRVIEW<CHARTYPE>& description)
 	{
-	public:
-		inline CopyrightHolder(const CHARTYPE* copyright);
-		inline typename TSTR<CHARTYPE>::type copyright() const;
+		help_record h;
+		h.kind = kind;
+		h.mandatory = mandatory;
+		h.shortName = shortName.empty() ? CHARTYPE() : shortName[0];
+		h.longName = longName;
+		h.description = description;
+		h.len = 0;
+		h.letter = CHARTYPE();
+		helps_.push_back(h);
+		usageValid_ = false;
+	}
 
-		template<typename C>
-		friend argstream<C>& operator>>(argstream<C>& s, CopyrightHolder<C> const& e);
-	private:
-		typename TSTR<CHARTYPE>::type copyright_;
-	};
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	// Implementation of CopyrightHolder<CHARTYPE>
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 	template<typename CHARTYPE>
-	inline CopyrightHolder<CHARTYPE>::CopyrightHolder(const CHARTYPE* copyright)
-		:copyright_(copyright)
+	template<typename... HOLDERS>
+	inline argstream<CHARTYPE>&
+	argstream<CHARTYPE>::bind(const HOLDERS&... holders)
 	{
+		ARGSTREAM_PHASE(CHARTYPE, PHASE_BIND, resource_, TSTRVIEW<CHARTYPE>());
+		// The bindings and the hash of the names live on the stack, one
+		// binding more than needed so that bind() without holder compiles.
+		binding bindings[sizeof...(HOLDERS) + 1];
+		size_t table[bindingTableSize(sizeof...(HOLDERS))];
+		size_t n = 0;
+		int expand[] = { 0, (collect(bindings[n++], holders), 0)... };
+		(void)expand;
+		resolve(bindings, n, table, sizeof(table) / sizeof(table[0]));
+		return *this;
 	}
 
 	template<typename CHARTYPE>
-	inline typename TSTR<CHARTYPE>::type CopyrightHolder<CHARTYPE>::copyright() const
+	template<typename T>
+	inline void
+	argstream<CHARTYPE>::collect(binding& b, const ValueHolder<CHARTYPE, T>& v)
 	{
-		return copyright_;
+		declareHolder(v);
+		b.help = helps_.size() - 1;
+		b.holder = &v;
+		b.apply = &apply<ValueHolder<CHARTYPE, T> >;
+		b.names[0] = v.shortName_;
+		b.names[1] = v.longName_;
+		b.checksHelp = false;
 	}
 
 	template<typename CHARTYPE>
-	inline argstream<CHARTYPE>&
-    operator >>(argstream<CHARTYPE>& s, CopyrightHolder<CHARTYPE> const& v)
+	ARGSTREAM_INLINE void
+	argstream<CHARTYPE>::collect(binding& b, const OptionHolder<CHARTYPE>& v)
 	{
-		s.copyright_ = v.copyright();
-		return s;
+		declareHolder(v);
+		b.help = helps_.size() - 1;
+		b.holder = &v;
+		b.apply = &apply<OptionHolder<CHARTYPE> >;
+		b.names[0] = v.shortName_;
+		b.names[1] = v.longName_;
+		b.checksHelp = true;
 	}
 
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	// Interface of ExampleHolder<CHARTYPE>
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	template <typename CHARTYPE>
-	class ExampleHolder
+	template<typename CHARTYPE>
+	template<typename T, typename O>
+	inline void
+	argstream<CHARTYPE>::collect(binding& b, const ValuesHolder<CHARTYPE, T, O>& v)
 	{
-	public:
-		ExampleHolder(const CHARTYPE* cmdline, const CHARTYPE* desc);
-		typename TSTR<CHARTYPE>::type cmdline() const;
-		typename TSTR<CHARTYPE>::type description() const;
-		template<typename C>
-		friend argstream<C>& operator>>(argstream<C>& s, ExampleHolder<C> const& e);
-	private:
-		typename TSTR<CHARTYPE>::type cmdline_;
-		typename TSTR<CHARTYPE>::type description_;
-	};
+		declareHolder(v);
+		b.help = helps_.size() - 1;
+		b.holder = &v;
+		b.apply = &apply<ValuesHolder<CHARTYPE, T, O> >;
+		b.names[0] = b.names[1] = TSTRVIEW<CHARTYPE>();
+		b.checksHelp = false;
+	}
 
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	// Implementation of ExampleHolder<CHARTYPE>
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 	template<typename CHARTYPE>
-	ExampleHolder<CHARTYPE>::ExampleHolder(const CHARTYPE* cmdline, const CHARTYPE* desc)
-		:cmdline_(cmdline), description_(desc)
+	ARGSTREAM_INLINE void
+	argstream<CHARTYPE>::collect(binding& b, const ExampleHolder<CHARTYPE>& v)
 	{
+		*this >> v;
+		b.holder = NULL;
+		b.apply = NULL;
+		b.names[0] = b.names[1] = TSTRVIEW<CHARTYPE>();
+		b.checksHelp = false;
 	}
 
 	template<typename CHARTYPE>
-	typename TSTR<CHARTYPE>::type
-    ExampleHolder<CHARTYPE>::cmdline() const
+	ARGSTREAM_INLINE void
+	argstream<CHARTYPE>::collect(binding& b, const CopyrightHolder<CHARTYPE>& v)
 	{
-		return cmdline_;
+		*this >> v;
+		b.holder = NULL;
+		b.apply = NULL;
+		b.names[0] = b.names[1] = TSTRVIEW<CHARTYPE>();
+		b.checksHelp = false;
 	}
 
 	template<typename CHARTYPE>
-	typename TSTR<CHARTYPE>::type ExampleHolder<CHARTYPE>::description() const
+	template<typename HOLDER>
+	inline void
+	argstream<CHARTYPE>::apply(argstream<CHARTYPE>& s, const void* holder, size_t option, size_t help)
 	{
-		return description_;
+		s.bindHolder(*static_cast<const HOLDER*>(holder), option, help);
 	}
 
 	template<typename CHARTYPE>
-	inline argstream<CHARTYPE>&
-    operator >>(argstream<CHARTYPE>& s, ExampleHolder<CHARTYPE> const& v)
+	ARGSTREAM_INLINE void
+	argstream<CHARTYPE>::resolve(binding* bindings, size_t n, size_t* table, size_t size)
 	{
-		s.argExamples_.push_back(argstream<CHARTYPE>::example_entry(v.cmdline(), v.description()));
-		return s;
+		// Hash the names of the holders. A bucket holds 1 + 2 * binding, plus
+		// one for a long name, 0 when empty. Holders sharing a name are
+		// chained through next.
+		std::fill(table, table + size, size_t(0));
+		bool checksHelp = false;
+		for (size_t i = 0; i < n; ++i)
+		{
+			binding& b = bindings[i];
+			checksHelp |= b.checksHelp;
+			for (size_t l = 0; l < 2; ++l)
+			{
+				b.found[l] = b.next[l] = npos;
+				const TSTRVIEW<CHARTYPE>& name = b.names[l];
+				if (name.empty())
+				{
+					continue;
+				}
+				size_t h = schema<CHARTYPE>::hash(name, 0) & (size - 1);
+				while (table[h] != 0 &&
+					bindings[(table[h] - 1) / 2].names[(table[h] - 1) % 2] != name)
+				{
+					h = (h + 1) & (size - 1);
+				}
+				if (table[h] != 0)
+				{
+					b.next[l] = table[h] - 1;
+				}
+				table[h] = 1 + 2 * i + l;
+			}
+		}
+
+		// Single pass over the tokens. Since indexOptions() only the last
+		// occurrence of each option is left unconsumed.
+		const TSTRVIEW<CHARTYPE> helpNames[2] = {
+			ARGSTREAM_LITERAL(CHARTYPE, "h"), ARGSTREAM_LITERAL(CHARTYPE, "help") };
+		size_t help[2] = { npos, npos };
+		for (size_t t = 0; t < tokens_.size(); ++t)
+		{
+			const token& tok = tokens_[t];
+			if (tok.kind != TOKEN_OPTION || isConsumed(t))
+			{
+				continue;
+			}
+			if (checksHelp && !isSetting(t))
+			{
+				if (tok.text == helpNames[0]) help[0] = t;
+				if (tok.text == helpNames[1]) help[1] = t;
+			}
+			for (size_t h = schema<CHARTYPE>::hash(tok.text, 0) & (size - 1);
+				table[h] != 0; h = (h + 1) & (size - 1))
+			{
+				size_t key = table[h] - 1;
+				if (bindings[key / 2].names[key % 2] == tok.text)
+				{
+					for (; key != npos; key = bindings[key / 2].next[key % 2])
+					{
+						if (key % 2 == 1 || !isSetting(t))
+						{
+							bindings[key / 2].found[key % 2] = t;
+						}
+					}
+					break;
+				}
+			}
+		}
+
+		// Bind in the order of declaration. An option consumed by a previous
+		// holder is not seen by the next ones, as with findOption().
+		for (size_t i = 0; i < n; ++i)
+		{
+			const binding& b = bindings[i];
+			if (b.apply == NULL)
+			{
+				continue;
+			}
+			if (b.checksHelp &&
+				((help[0] != npos && !isConsumed(help[0])) ||
+				 (help[1] != npos && !isConsumed(help[1]))))
+			{
+				helpRequested_ = true;
+			}
+			size_t found[2];
+			for (size_t l = 0; l < 2; ++l)
+			{
+				found[l] = b.found[l] != npos && !isConsumed(b.found[l]) ? b.found[l] : npos;
+			}
+			b.apply(*this, b.holder, chooseOption(found[0], found[1]), b.help);
+		}
 	}
 
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	// Interface of OptionHolder<CHARTYPE>
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	template <typename CHARTYPE>
-	class OptionHolder
+	template<typename CHARTYPE>
+	inline bool
+	argstream<CHARTYPE>::isOk() const
 	{
-	public:
-		inline OptionHolder(
-			CHARTYPE s,
-			const CHARTYPE* l,
-			bool& b,
-			const CHARTYPE* desc);
-		inline OptionHolder(
-			const CHARTYPE* l,
-			bool& b,
-			const CHARTYPE* desc);
-		inline OptionHolder(
-			CHARTYPE s,
-			bool& b,
-			const CHARTYPE* desc);
-		inline OptionHolder(CHARTYPE s,
-			const CHARTYPE* l,
-			const CHARTYPE* desc);
+		return isOk_;
+	}
 
-		inline typename TSTR<CHARTYPE>::type name() const;
-		inline typename TSTR<CHARTYPE>::type description() const;
+	template<typename CHARTYPE>
+	inline bool
+	argstream<CHARTYPE>::helpRequested() const
+	{
+		return helpRequested_;
+	}
 
-		template<typename C>
-		friend argstream<C>& operator>>(argstream<C>& s, OptionHolder<C> const& v);
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE typename TSTR<CHARTYPE>::type
+	argstream<CHARTYPE>::usage() const
+	{
+		ARGSTREAM_PHASE(CHARTYPE, PHASE_USAGE, resource_, TSTRVIEW<CHARTYPE>());
+		if (!usageValid_)
+		{
+			usage_.clear();
+			StringSink<CHARTYPE, string_type> out(usage_);
+			writeUsage(out);
+			usageValid_ = true;
+		}
+		return typename TSTR<CHARTYPE>::type(usage_.data(), usage_.size());
+	}
 
-		friend OptionHolder<CHARTYPE> help<CHARTYPE>();
-	private:
-		typename TSTR<CHARTYPE>::type shortName_;
-		typename TSTR<CHARTYPE>::type longName_;
-		bool* value_;
-		typename TSTR<CHARTYPE>::type description_;
-	};
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE typename TSTRSTREAM<CHARTYPE>::COUT&
+	argstream<CHARTYPE>::usage(typename TSTRSTREAM<CHARTYPE>::COUT& os) const
+	{
+		ARGSTREAM_PHASE(CHARTYPE, PHASE_USAGE, resource_, TSTRVIEW<CHARTYPE>());
+		StreamSink<CHARTYPE> out(os);
+		if (usageValid_)
+		{
+			out.put(usage_);
+		}
+		else
+		{
+			writeUsage(out);
+		}
+		return os;
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE bool
+	argstream<CHARTYPE>::usage(int fd) const
+	{
+		ARGSTREAM_PHASE(CHARTYPE, PHASE_USAGE, resource_, TSTRVIEW<CHARTYPE>());
+		FdSink<CHARTYPE> out(fd);
+		if (usageValid_)
+		{
+			out.put(usage_);
+		}
+		else
+		{
+			writeUsage(out);
+		}
+		return out.flush();
+	}
+
+	template<typename CHARTYPE>
+	inline size_t
+	argstream<CHARTYPE>::nameSize(const help_record& h) const
+	{
+		// Size of the name written by writeUsage(), -s/--long or ai
+		if (h.kind == HELP_VALUES)
+		{
+			return 2;
+		}
+		size_t n = h.shortName != CHARTYPE() ? 2 : 0;
+		if (!h.longName.empty())
+		{
+			n += (n ? 1 : 0) + 2 + h.longName.size();
+		}
+		return n;
+	}
+
+	template<typename CHARTYPE>
+	template<typename SINK>
+	inline void
+	argstream<CHARTYPE>::writeName(SINK& out, const help_record& h) const
+	{
+		if (h.kind == HELP_VALUES)
+		{
+			out.put(h.letter);
+			out.put('i');
+			return;
+		}
+		if (h.shortName != CHARTYPE())
+		{
+			out.put('-');
+			out.put(h.shortName);
+		}
+		if (!h.longName.empty())
+		{
+			out.put(h.shortName != CHARTYPE() ? ARGSTREAM_LITERAL(CHARTYPE, "/--") : ARGSTREAM_LITERAL(CHARTYPE, "--"));
+			out.put(h.longName);
+		}
+	}
+
+	template<typename CHARTYPE>
+	template<typename SINK>
+	inline void
+	argstream<CHARTYPE>::writeUsage(SINK& out) const
+	{
+		if (copyright_.size())
+		{
+			out.put(copyright_);
+			out.put('\n');
+			out.put('\n');
+		}
+		out.put(ARGSTREAM_LITERAL(CHARTYPE, "Usage: "));
+		out.put(progName_);
+		// The options come first, the last declared one first, followed by
+		// the parameters and values in the order of declaration.
+		for (typename std::vector<help_record, resource_allocator<help_record> >::const_reverse_iterator iter = helps_.rbegin();
+			iter != helps_.rend();++iter)
+		{
+			if (iter->kind != HELP_OPTION) continue;
+			if (iter->shortName != CHARTYPE())
+			{
+				out.put(ARGSTREAM_LITERAL(CHARTYPE, " [-"));
+				out.put(iter->shortName);
+			}
+			else
+			{
+				out.put(ARGSTREAM_LITERAL(CHARTYPE, " [--"));
+				out.put(iter->longName);
+			}
+			out.put(']');
+		}
+		for (const help_record& h:helps_)
+		{
+			switch (h.kind)
+			{
+			case HELP_VALUE:
+			case HELP_SWITCH:
+				out.put(h.mandatory ? ARGSTREAM_LITERAL(CHARTYPE, " -") : ARGSTREAM_LITERAL(CHARTYPE, " [-"));
+				if (h.shortName != CHARTYPE())
+				{
+					out.put(h.shortName);
+				}
+				else
+				{
+					out.put('-');
+					out.put(h.longName);
+				}
+				if (h.kind == HELP_VALUE) out.put(ARGSTREAM_LITERAL(CHARTYPE, " value"));
+				if (!h.mandatory) out.put(']');
+				break;
+			case HELP_VALUES:
+				out.put(' ');
+				out.put(h.letter);
+				out.put('1');
+				switch (h.len)
+				{
+				case -1:
+					out.put(ARGSTREAM_LITERAL(CHARTYPE, " ..."));
+					break;
+				case 1:
+					break;
+				default:
+					out.put(ARGSTREAM_LITERAL(CHARTYPE, " ... "));
+					out.put(h.letter);
+					out.number(h.len);
+					break;
+				}
+				break;
+			default:
+				break;
+			}
+		}
+		out.put('\n');
+
+		size_t lmax = 0;
+		for (const help_record& h:helps_)
+		{
+			lmax = std::max(lmax, nameSize(h));
+		}
+		for (const help_record& h:helps_)
+		{
+			out.put('\t');
+			writeName(out, h);
+			out.fill(' ', lmax - nameSize(h));
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, " : "));
+			out.put(h.description);
+			if (!h.env.empty())
+			{
+				out.put(ARGSTREAM_LITERAL(CHARTYPE, " ($"));
+				out.put(h.env);
+				out.put(')');
+			}
+			out.put('\n');
+		}
+
+		// Append the examples
+		long i = 1;
+		for (const example_entry& example:examples_)
+		{
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, "\n----------\nExample "));
+			out.number(i++);
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, "\n----------\nCommand: \n\t"));
+			out.put(example.first);
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, "\n\nDescription:\n\t"));
+			out.put(example.second);
+			out.put('\n');
+		}
+	}
 
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	// Implementation of OptionHolder<CHARTYPE>
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 	template<typename CHARTYPE>
-	inline OptionHolder<CHARTYPE>::OptionHolder(
-		CHARTYPE s,
-		const CHARTYPE* l,
-		bool& b,
-		const CHARTYPE* desc)
-		: shortName_(1,s),
-		longName_(l),
-		value_(&b),
-		description_(desc)
+	ARGSTREAM_INLINE typename TSTR<CHARTYPE>::type
+	argstream<CHARTYPE>::errorLog() const
 	{
+		ARGSTREAM_PHASE(CHARTYPE, PHASE_ERROR_LOG, resource_, TSTRVIEW<CHARTYPE>());
+		typename TSTR<CHARTYPE>::type s;
+		StringSink<CHARTYPE, typename TSTR<CHARTYPE>::type> out(s);
+		writeErrors(out);
+		return s;
 	}
 
 	template<typename CHARTYPE>
-	inline OptionHolder<CHARTYPE>::OptionHolder(
-		const CHARTYPE* l,
-		bool& b,
-		const CHARTYPE* desc)
-		: longName_(l),
-		value_(&b),
-		description_(desc)
+	ARGSTREAM_INLINE typename TSTRSTREAM<CHARTYPE>::COUT&
+	argstream<CHARTYPE>::errorLog(typename TSTRSTREAM<CHARTYPE>::COUT& os) const
 	{
+		ARGSTREAM_PHASE(CHARTYPE, PHASE_ERROR_LOG, resource_, TSTRVIEW<CHARTYPE>());
+		StreamSink<CHARTYPE> out(os);
+		writeErrors(out);
+		return os;
 	}
 
 	template<typename CHARTYPE>
-	inline OptionHolder<CHARTYPE>::OptionHolder(
-		CHARTYPE s,
-		bool& b,
-		const CHARTYPE* desc)
-		: shortName_(1,s),
-		value_(&b),
-		description_(desc)
+	ARGSTREAM_INLINE bool
+	argstream<CHARTYPE>::errorLog(int fd) const
 	{
+		ARGSTREAM_PHASE(CHARTYPE, PHASE_ERROR_LOG, resource_, TSTRVIEW<CHARTYPE>());
+		FdSink<CHARTYPE> out(fd);
+		writeErrors(out);
+		return out.flush();
 	}
 
 	template<typename CHARTYPE>
-	inline OptionHolder<CHARTYPE>::OptionHolder(
-		CHARTYPE s,
-		const CHARTYPE* l,
-		const CHARTYPE* desc)
-		: shortName_(1,s),
-		longName_(l),
-		value_(NULL),
-		description_(desc)
+	template<typename SINK>
+	inline void
+	argstream<CHARTYPE>::writeErrors(SINK& out) const
 	{
+		for (const error_record& e:errors_)
+		{
+			writeError(out, e);
+			out.put('\n');
+		}
 	}
 
 	template<typename CHARTYPE>
-	inline typename TSTR<CHARTYPE>::type OptionHolder<CHARTYPE>::name() const
+	template<typename SINK>
+	inline void
+	argstream<CHARTYPE>::writeError(SINK& out, const error_record& e) const
 	{
-		typename TSTRSTREAM<CHARTYPE>::O os;
-		if (!shortName_.empty()) os<<'-'<<shortName_;
-		if (!longName_.empty())
+		switch (e.code)
 		{
-			if (!shortName_.empty()) os<<'/';
-			os<<TSTR<CHARTYPE>::ToString("--")<<longName_;
+		case ERR_MINUS_IN_SWITCH:
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, "- in the middle of a switch "));
+			out.put(e.argument);
+			break;
+		case ERR_LONE_MINUS:
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, "Invalid argument -"));
+			break;
+		case ERR_RESPONSE_FILE:
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, "Cannot read response file "));
+			out.put(e.argument);
+			break;
+		case ERR_RESPONSE_FILE_CYCLE:
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, "Response file "));
+			out.put(e.argument);
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, " includes itself"));
+			break;
+		case ERR_CONFIG_FILE:
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, "Cannot read configuration file "));
+			out.put(e.argument);
+			break;
+		case ERR_CONFIG_LINE:
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, "Invalid configuration line "));
+			out.put(e.argument);
+			break;
+		case ERR_NO_VALUE:
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, "No value following switch "));
+			out.put(e.argument);
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, " on command line"));
+			break;
+		case ERR_INVALID_VALUE:
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, "Invalid value "));
+			out.put(e.argument);
+			if (e.holder != npos && e.token == npos && !helps_[e.holder].env.empty())
+			{
+				// Read by findEnvironment()
+				out.put(ARGSTREAM_LITERAL(CHARTYPE, " of environment variable "));
+				out.put(helps_[e.holder].env);
+			}
+			else if (e.holder != npos && e.token != npos && helps_[e.holder].kind != HELP_VALUES)
+			{
+				// A parameter() value, the switch is the option linked to it
+				for (const token& t:tokens_)
+				{
+					if (t.kind == TOKEN_OPTION && t.value == e.token)
+					{
+						out.put(ARGSTREAM_LITERAL(CHARTYPE, " following switch "));
+						out.put(t.text);
+						break;
+					}
+				}
+			}
+			break;
+		case ERR_MISSING_MANDATORY:
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, "Mandatory parameter "));
+			writeName(out, helps_[e.holder]);
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, " missing"));
+			break;
+		case ERR_MISSING_VALUES:
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, "Expecting "));
+			out.number(helps_[e.holder].len);
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, " values"));
+			break;
+		case ERR_READ_VALUES:
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, "Cannot read the values from the input"));
+			break;
+		case ERR_UNUSED:
+			out.put(ARGSTREAM_LITERAL(CHARTYPE, "Unused argument "));
+			if (e.token != npos && tokens_[e.token].kind == TOKEN_OPTION)
+			{
+				out.put('-');
+				if (e.argument.size() > 1) out.put('-');
+			}
+			out.put(e.argument);
+			break;
 		}
-		return os.str();
 	}
 
 	template<typename CHARTYPE>
-	inline typename TSTR<CHARTYPE>::type OptionHolder<CHARTYPE>::description() const
+	ARGSTREAM_INLINE typename TSTR<CHARTYPE>::type
+	argstream<CHARTYPE>::errorMessage(const error_record& e) const
 	{
-		return description_;
+		typename TSTR<CHARTYPE>::type s;
+		StringSink<CHARTYPE, typename TSTR<CHARTYPE>::type> out(s);
+		writeError(out, e);
+		return s;
 	}
 
-	/* ValusesHolder is not used currently, disable it temporarily
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	// Interface of ValuesHolder<CHARTYPE, T, O>
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	template<typename CHARTYPE, typename T, typename O>
-	class ValuesHolder
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE RESULT_OF_PARSE
+	argstream<CHARTYPE>::defaultErrorHandling(bool ignoreUnused) const
 	{
-	public:
-		ValuesHolder(const O& o,
-			const CHARTYPE* desc,
-			int len);
-
-		template<typename C, typename T2, typename O2>
-		friend argstream<C>& operator>>(argstream<C>& s, ValuesHolder<C, T2, O2> const& v);
-		typename TSTR<CHARTYPE>::type name() const;
-		typename TSTR<CHARTYPE>::type description() const;
-		typedef T value_type;
-	private:
-		mutable O   value_;
-		typename TSTR<CHARTYPE>::type description_;
-		int len_;
-		CHARTYPE letter_;
-	};
+		if (helpRequested_)
+		{
+			return RESULT_OF_PARSE::PARSED_ERR_HELP_REQUESTED;
+		}
+		if (!isOk_)
+		{
+			return RESULT_OF_PARSE::PARSED_ERR_OTHER;
+		}
+		if (!ignoreUnused && hasUnused())
+		{
+			return RESULT_OF_PARSE::PARSED_ERR_UNUSED_PARAMETER;
+		}
+		return RESULT_OF_PARSE::PARSED_OK;
+	}
 
 	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	// Implementation of ValuesHolder<CHARTYPE, T, O>
+	// Interface of schema<CHARTYPE>
 	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	template<typename CHARTYPE, typename T, typename O>
-	ValuesHolder<CHARTYPE, T, O>::ValuesHolder(
-		const O& o,
-		const CHARTYPE* desc,
-		int len)
-		: value_(o),
-		description_(desc),
-		len_(len)
+
+	/**
+		One column of a batch, it stores the values of one slot of the schema
+		for all the parsed command lines.
+	*/
+	template<typename CHARTYPE>
+	class SchemaColumn
 	{
-		letter_ = argstream::uniqueLetter();
-	}
+	public:
+		virtual ~SchemaColumn() {}
+		virtual void reserve(size_t rows) = 0;
+		virtual void resize(size_t rows) = 0;
+		virtual bool assign(size_t row, const TSTRVIEW<CHARTYPE>& s) = 0;
+		virtual void set(size_t, bool) {}
+	};
 
-	template <typename CHARTYPE, typename T, typename O>
-	typename TSTR<CHARTYPE>::type
-	ValuesHolder<CHARTYPE, T, O>::name() const
+	/**
+		Type of the elements of a column. Booleans are stored as unsigned char
+		so that the rows of a column can be written independently.
+	*/
+	template<typename T>
+	struct ColumnType
 	{
-		TSTRSTREAM<CHARTYPE>::O os;
-		os<< letter_ <<TSTR<CHARTYPE>::ToString("i");
-		return os.str();
-	}
+		typedef T type;
+	};
 
-	template <typename CHARTYPE, typename T, typename O>
-	typename TSTR<CHARTYPE>::type
-	ValuesHolder<CHARTYPE, T, O>::description() const
+	template<>
+	struct ColumnType<bool>
 	{
-		return description_;
-	}
+		typedef unsigned char type;
+	};
 
-	template<typename CHARTYPE, typename T, typename O>
-	argstream<CHARTYPE>& operator >>(argstream<CHARTYPE>& s,ValuesHolder<CHARTYPE,T,O> const& v)
+	template<typename CHARTYPE, typename T>
+	class ValueColumn : public SchemaColumn<CHARTYPE>
 	{
-		s.argHelps_.push_back(argstream::help_entry(v.name(),v.description()));
+	public:
+		inline explicit ValueColumn(const T& initialValue)
+			: initialValue_(initialValue)
 		{
-			STRSTREAM<CHARTYPE>::O os;
-			os<<' '<<v.letter_<<'1';
-			switch (v.len_)
-			{
-			case -1:
-				os<< TSTR<CHARTYPE>::ToString("...");
-				break;
-			case 1:
-				break;
-			default:
-				os<< TSTR<CHARTYPE>::ToString("...") << v.letter_ << v.len_;
-				break;
-			}
-			s.cmdLine_ += os.str();
 		}
-		std::list<TSTR<CHARTYPE>::type>::iterator first = s.values_.begin();
-		// We add to the iterator as much values as we can, limited to the length
-		// specified (if different of -1)
-		int n = v.len_ != -1?v.len_:s.values_.size();
-		while (first != s.values_.end() && n-->0)
+		virtual void reserve(size_t rows)
+		{
+			values_.reserve(rows);
+		}
+		virtual void resize(size_t rows)
+		{
+			values_.resize(rows, initialValue_);
+		}
+		virtual bool assign(size_t row, const TSTRVIEW<CHARTYPE>& s)
 		{
-			// Read the value from the string *first
 			ValueParser<CHARTYPE, T> p;
-			*(v.value_++) = p(*first );
-			s.argHelps_.push_back(argstream::help_entry(v.name(),v.description()));
-			// The value we just removed was maybe "remembered" by an option so we
-			// remove it now.
-			for (std::map<typename TSTR<CHARTYPE>::type, typename argstream<CHARTYPE>::value_iterator>::iterator
-				jter = s.options_.begin();jter != s.options_.end();++jter)
+			T t = initialValue_;
+			if (!p(s, t))
 			{
-				if (jter->second == first)
-				{
-					jter->second = s.values_.end();
-				}
+				return false;
 			}
-			++first;
+			values_[row] = t;
+			return true;
 		}
-		// Check if we have enough values
-		if (n != 0)
+		inline const std::vector<typename ColumnType<T>::type>& values() const
 		{
-			s.isOk_ = false;
-			typename TSTRSTREAM<CHARTYPE>::O os;
-			os<<TSTR<CHARTYPE>::ToString("Expecting ")<<v.len_<<TSTR<CHARTYPE>::ToString(" values");
-			s.errors_.push_back(os.str());
+			return values_;
 		}
-		// Erase the values parsed
-		s.values_.erase(s.values_.begin(),first);
-		return s;
-	}
-	*/
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	// Interface and implementation of ValueParser<CHARTYPE, T>
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	template<typename CHARTYPE, typename T>
-	class ValueParser
+	protected:
+		std::vector<typename ColumnType<T>::type> values_;
+		T initialValue_;
+	};
+
+	template<typename CHARTYPE>
+	class OptionColumn : public ValueColumn<CHARTYPE, bool>
 	{
 	public:
-		inline T operator ()(const typename TSTR<CHARTYPE>::type& s) const
+		inline OptionColumn() : ValueColumn<CHARTYPE, bool>(false) {}
+		virtual void set(size_t row, bool b)
 		{
-			typename TSTRSTREAM<CHARTYPE>::I is(s);
-			T t;
-			is>>t;
-			return t;
+			this->values_[row] = b;
 		}
 	};
 
+	/**
+		Type erased access to the variable bound by a ValueHolder.
+	*/
 	template<typename CHARTYPE>
-	class ValueParser<CHARTYPE, typename TSTR<CHARTYPE>::type>
+	class SchemaBinding
+	{
+	public:
+		virtual ~SchemaBinding() {}
+		virtual void reset() const = 0;
+		virtual bool assign(const TSTRVIEW<CHARTYPE>& s) const = 0;
+		virtual SchemaColumn<CHARTYPE>* column() const = 0;
+	};
+
+	template<typename CHARTYPE, typename T>
+	class ValueBinding : public SchemaBinding<CHARTYPE>
 	{
 	public:
-		inline typename TSTR<CHARTYPE>::type
-		operator ()(const typename TSTR<CHARTYPE>::type& s) const
+		inline ValueBinding(T* value, const T& initialValue)
+			: value_(value), initialValue_(initialValue)
 		{
-			return s;
 		}
+		virtual void reset() const
+		{
+			*value_ = initialValue_;
+		}
+		virtual bool assign(const TSTRVIEW<CHARTYPE>& s) const
+		{
+			ValueParser<CHARTYPE, T> p;
+			return p(s, *value_);
+		}
+		virtual SchemaColumn<CHARTYPE>* column() const
+		{
+			return new ValueColumn<CHARTYPE, T>(initialValue_);
+		}
+	private:
+		T* value_;
+		T initialValue_;
 	};
 
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	// Interface of argstream<CHARTYPE>
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	/**
+		The parameters and options declared with operator>> are compiled into
+		a table of slots and a hash of all their short and long names, built
+		once by the first parse() or find(). The hash is an open addressing
+		table at most half full, so that each argument of a command line is
+		resolved in constant time, in one pass over argv, and the values are
+		stored in the variables bound by the holders.
+
+		parse() follows the rules of argstream: a value following an option
+		is linked to it, the last occurrence of an option wins, the short
+		name has precedence over the long name, and the result is the one
+		defaultErrorHandling() would return. Before each parse the bound
+		variables are reset to the value they had when they were declared.
+
+		parse() writes the variables bound when the schema was declared, so
+		a schema must not be parsed from several threads at the same time.
+		Only batch parses one schema from several threads, its rows are
+		written instead of the variables.
+	*/
 	template<typename CHARTYPE>
-	class argstream
+	class schema
 	{
 	public:
-		inline argstream<CHARTYPE>(int argc,CHARTYPE const* const argv[]);
-		inline argstream<CHARTYPE>(const CHARTYPE* c);
+		inline schema();
+
+		friend class argstream<CHARTYPE>;
 
 		template<typename C, typename T>
-		friend argstream<C>& operator>>(
-			argstream<C>& s,
+		friend schema<C>& operator>>(
+			schema<C>& s,
 			ValueHolder<C, T> const& v);
-	
+
 		template<typename C>
-		friend argstream<C>& operator>>(
-			argstream<C>& s,
+		friend schema<C>& operator>>(
+			schema<C>& s,
 			OptionHolder<C> const& v);
-		/*
-		template<typename T, typename O>
-		friend argstream<CHARTYPE>& operator>>(
-			argstream<CHARTYPE>& s,
-			ValuesHolder<CHARTYPE, T,O> const& v);
-		*/
-		
-		template<typename C>
-		friend argstream<C>& operator>>(
-			argstream<C>& s,
-			ExampleHolder<C> const& v);
 
 		template<typename C>
-		friend argstream<C>& operator>>(
-			argstream<C>& s,
-			CopyrightHolder<C> const& v);
+		friend class batch;
 
-		inline bool helpRequested() const;
-		inline bool isOk() const;
-		inline typename TSTR<CHARTYPE>::type errorLog() const;
-		inline typename TSTR<CHARTYPE>::type usage() const;
-		inline RESULT_OF_PARSE defaultErrorHandling(bool ignoreUnused=false) const;
+		/**
+			Parse a command line, argv[0] is the program name.
+
+			@param argc Number of arguments.
+			@param argv The arguments.
+			@param ignoreUnused Do not report unused arguments.
+
+			@return The same result as argstream::defaultErrorHandling().
+		*/
+		inline RESULT_OF_PARSE parse(
+			int argc,
+			CHARTYPE const* const argv[],
+			bool ignoreUnused = false) const;
+
+		/**
+			Parse a command line and append the error messages to errors.
+		*/
+		inline RESULT_OF_PARSE parse(
+			int argc,
+			CHARTYPE const* const argv[],
+			std::deque<typename TSTR<CHARTYPE>::type>& errors,
+			bool ignoreUnused = false) const;
+
+		/**
+			Index of the slot declared with the given short or long name.
+
+			@return The index in declaration order, npos if none.
+		*/
+		inline size_t find(const TSTRVIEW<CHARTYPE>& name) const;
+
+		inline size_t size() const;
+
+		/**
+			Number of buckets of the hash of the names, a power of two
+			between two and four times the number of names (8 at least).
+		*/
+		inline size_t buckets() const;
+
+		static const size_t npos = static_cast<size_t>(-1);
 	protected:
-		void parse(int argc, CHARTYPE const* const argv[]);
+		/**
+			Parse a command line and hand the values to sink, which is either
+			the variables bound by the holders or a row of a batch.
+		*/
+		template<typename SINK, typename SCRATCH>
+		inline RESULT_OF_PARSE parse(
+			int argc,
+			CHARTYPE const* const argv[],
+			std::deque<typename TSTR<CHARTYPE>::type>* errors,
+			bool ignoreUnused,
+			const SINK& sink,
+			SCRATCH& occurrences) const;
 	private:
-		typedef CHARTYPE* PCHARTYPE;
-		typedef typename std::list<typename TSTR<CHARTYPE>::type>::iterator value_iterator;
-		typedef typename std::pair<typename TSTR<CHARTYPE>::type, typename TSTR<CHARTYPE>::type> help_entry;
-		typedef typename std::pair<typename TSTR<CHARTYPE>::type, typename TSTR<CHARTYPE>::type> example_entry;
-		typename TSTR<CHARTYPE>::type progName_;
-		typename TSTR<CHARTYPE>::type cmdLine_;
-		typename TSTR<CHARTYPE>::type copyright_;
-		std::map<typename TSTR<CHARTYPE>::type, value_iterator> options_;
-		std::list<typename TSTR<CHARTYPE>::type> values_;
-		bool minusActive_;
-		bool isOk_;
-		std::unique_ptr<PCHARTYPE> argv_from_cmdline_;
-		std::deque<std::pair<typename TSTR<CHARTYPE>::type, typename TSTR<CHARTYPE>::type>> argHelps_;
-		std::deque<std::pair<typename TSTR<CHARTYPE>::type, typename TSTR<CHARTYPE>::type>> argExamples_;
-		std::deque<typename TSTR<CHARTYPE>::type> errors_;
-		bool helpRequested_;
+		/**
+			Store the values in the variables bound by the holders.
+		*/
+		struct variable_sink
+		{
+			const schema<CHARTYPE>& s;
+			inline void reset(size_t i) const
+			{
+				s.slots_[i].binding->reset();
+			}
+			inline bool assign(size_t i, const TSTRVIEW<CHARTYPE>& v) const
+			{
+				return s.slots_[i].binding->assign(v);
+			}
+			inline void set(size_t i, bool b) const
+			{
+				if (s.slots_[i].option != NULL) *s.slots_[i].option = b;
+			}
+		};
+
+		typedef enum
+		{
+			SLOT_VALUE = 0,
+			SLOT_OPTION
+		} SLOT_KIND;
+
+		struct slot
+		{
+			SLOT_KIND kind;
+			typename TSTR<CHARTYPE>::type shortName;
+			typename TSTR<CHARTYPE>::type longName;
+			bool mandatory;
+			bool* option;                                       // SLOT_OPTION only
+			std::shared_ptr<const SchemaBinding<CHARTYPE> > binding; // SLOT_VALUE only
+		};
+
+		// A bucket of the hash refers to the short (name == 0) or the long
+		// (name == 1) name of a slot.
+		struct bucket
+		{
+			size_t slot;
+			int name;
+		};
+
+		// Occurrences of a slot on the command line, by short and long name.
+		struct occurrence
+		{
+			bool seen[2];
+			bool hasValue[2];
+			TSTRVIEW<CHARTYPE> value[2];
+		};
+
+		static inline unsigned int hash(const TSTRVIEW<CHARTYPE>& s, unsigned int seed);
+		inline const typename TSTR<CHARTYPE>::type& keyOf(const bucket& b) const;
+		inline bool lookup(const TSTRVIEW<CHARTYPE>& name, bucket& b) const;
+		inline void add(const slot& sl);
+		inline void compile() const;
+
+		std::vector<slot> slots_;
+		// Built by compile() when first needed, empty buckets have slot == npos
+		mutable std::vector<bucket> table_;
+		mutable size_t mask_;
+		mutable bool compiled_;
+		bool hasOption_;
 	};
 
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	// Implementation of argstream<CHARTYPE>
-	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Implementation of schema<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template<typename CHARTYPE>
+	const size_t schema<CHARTYPE>::npos;
+
+	template<typename CHARTYPE>
+	inline schema<CHARTYPE>::schema()
+		: mask_(0),
+		compiled_(false),
+		hasOption_(false)
+	{
+	}
+
+	template<typename CHARTYPE>
+	inline size_t
+	schema<CHARTYPE>::size() const
+	{
+		return slots_.size();
+	}
+
+	template<typename CHARTYPE>
+	inline size_t
+	schema<CHARTYPE>::buckets() const
+	{
+		compile();
+		return table_.size();
+	}
+
+	template<typename CHARTYPE>
+	inline unsigned int
+	schema<CHARTYPE>::hash(const TSTRVIEW<CHARTYPE>& s, unsigned int seed)
+	{
+		// FNV-1a, seeded
+		unsigned int h = 2166136261u ^ (seed * 0x9E3779B9u);
+		for (typename TSTRVIEW<CHARTYPE>::const_iterator iter = s.begin(); iter != s.end(); ++iter)
+		{
+			h ^= static_cast<unsigned int>(*iter);
+			h *= 16777619u;
+		}
+		return h ^ (h >> 15);
+	}
+
+	template<typename CHARTYPE>
+	inline const typename TSTR<CHARTYPE>::type&
+	schema<CHARTYPE>::keyOf(const bucket& b) const
+	{
+		return b.name == 0 ? slots_[b.slot].shortName : slots_[b.slot].longName;
+	}
+
 	template<typename CHARTYPE>
-	inline argstream<CHARTYPE>::argstream(int argc, CHARTYPE const* const argv[])
-		: progName_(),
-		minusActive_(true),
-		isOk_(true),
-		argv_from_cmdline_(nullptr),
-		helpRequested_(false)
+	inline bool
+	schema<CHARTYPE>::lookup(const TSTRVIEW<CHARTYPE>& name, bucket& b) const
 	{
-		typename TSTR<CHARTYPE>::type argv0(argv[0]);
-		size_t found = argv0.find_last_of(TSTR<CHARTYPE>::ToString("/\\"));
-		progName_ = argv0.substr(found+1);
-		parse(argc,argv);
+		compile();
+		for (size_t h = hash(name, 0) & mask_; table_[h].slot != npos; h = (h + 1) & mask_)
+		{
+			if (TSTRVIEW<CHARTYPE>(keyOf(table_[h])) == name)
+			{
+				b = table_[h];
+				return true;
+			}
+		}
+		return false;
 	}
 
 	template<typename CHARTYPE>
-	inline argstream<CHARTYPE>::argstream(const CHARTYPE* c)
-		: progName_(TSTR<CHARTYPE>::ToString("")),
-		minusActive_(true),
-		isOk_(true),
-		argv_from_cmdline_(nullptr),
-		helpRequested_(false)
+	inline size_t
+	schema<CHARTYPE>::find(const TSTRVIEW<CHARTYPE>& name) const
+	{
+		bucket b;
+		return lookup(name, b) ? b.slot : npos;
+	}
+
+	template<typename CHARTYPE>
+	inline void
+	schema<CHARTYPE>::add(const slot& sl)
 	{
-		typename TSTR<CHARTYPE>::type s(c);
-		// Build argc, argv from s. We must add a dummy first element for
-		// progName because parse() expects it!!
-		std::deque<typename TSTR<CHARTYPE>::type> args;
-		//args.push_back(TSTR<CHARTYPE>::ToString(""));
-		typename TSTRSTREAM<CHARTYPE>::I is(s);
-		while (is.good())
+		slots_.push_back(sl);
+		if (sl.kind == SLOT_OPTION)
 		{
-			typename TSTR<CHARTYPE>::type t;
-			is>>t;
-			args.push_back(t);
+			hasOption_ = true;
 		}
+		compiled_ = false;
+	}
 
-		argv_from_cmdline_.reset(new PCHARTYPE[args.size()]);
-		PCHARTYPE* p = argv_from_cmdline_.get();
-		for (typename std::deque<typename TSTR<CHARTYPE>::type>::const_iterator
-			iter = args.begin();
-			iter != args.end();++iter)
+	template<typename CHARTYPE>
+	inline void
+	schema<CHARTYPE>::compile() const
+	{
+		if (compiled_)
+		{
+			return;
+		}
+		// Insert the names with linear probing into a table at most half
+		// full. As with argstream, when a name is declared twice the first
+		// declaration gets it.
+		size_t names = 0;
+		for (const slot& sl : slots_)
 		{
-			*p++ = const_cast<CHARTYPE*>(iter->c_str());
+			names += !sl.shortName.empty() + !sl.longName.empty();
 		}
+		size_t size = 8;
+		while (size < 2 * names) size *= 2;
+		bucket empty = { npos, 0 };
+		table_.assign(size, empty);
+		mask_ = size - 1;
+		for (size_t i = 0; i < slots_.size(); ++i)
+		{
+			for (int n = 0; n < 2; ++n)
+			{
+				bucket b = { i, n };
+				const typename TSTR<CHARTYPE>::type& key = keyOf(b);
+				if (key.empty()) continue;
+				size_t h = hash(key, 0) & mask_;
+				while (table_[h].slot != npos && keyOf(table_[h]) != key)
+				{
+					h = (h + 1) & mask_;
+				}
+				if (table_[h].slot == npos) table_[h] = b;
+			}
+		}
+		compiled_ = true;
+	}
+
+	template<typename CHARTYPE>
+	inline RESULT_OF_PARSE
+	schema<CHARTYPE>::parse(
+		int argc,
+		CHARTYPE const* const argv[],
+		bool ignoreUnused) const
+	{
+		variable_sink sink = { *this };
+		std::vector<occurrence> occurrences;
+		return parse(argc, argv, NULL, ignoreUnused, sink, occurrences);
+	}
 
-		//PCHARTYPE* pc = argv_from_cmdline_.get();
-		parse(args.size(), argv_from_cmdline_.get());
+	template<typename CHARTYPE>
+	inline RESULT_OF_PARSE
+	schema<CHARTYPE>::parse(
+		int argc,
+		CHARTYPE const* const argv[],
+		std::deque<typename TSTR<CHARTYPE>::type>& errors,
+		bool ignoreUnused) const
+	{
+		variable_sink sink = { *this };
+		std::vector<occurrence> occurrences;
+		return parse(argc, argv, &errors, ignoreUnused, sink, occurrences);
 	}
 
 	template<typename CHARTYPE>
-	inline void argstream<CHARTYPE>::parse(int argc, CHARTYPE const* const argv[])
+	template<typename SINK, typename SCRATCH>
+	inline RESULT_OF_PARSE
+	schema<CHARTYPE>::parse(
+		int argc,
+		CHARTYPE const* const argv[],
+		std::deque<typename TSTR<CHARTYPE>::type>* errors,
+		bool ignoreUnused,
+		const SINK& sink,
+		SCRATCH& occurrences) const
 	{
-		// Run thru all arguments.
-		// * it has -- in front : it is a long name option, if remainder is empty,
-		//                        it is an error
-		// * it has - in front  : it is a sequence of short name options, if
-		//                        remainder is empty, deactivates option (- will
-		//                        now be considered a _TCHAR).
-		// * if any other _TCHAR, or if option was deactivated
-		//                      : it is a value. Values are split in parameters
-		//                      (immediately follow an option) and pure values.
-		// Each time a value is parsed, if the previously parsed argument was an
-		// option, then the option is linked to the value in case of it is a
-		// option with parameter.  The subtle point is that when several options
-		// are given with short names (ex: -abc equivalent to -a -b -c), the last
-		// parsed option is -c).
-		// Since we use map for option, any successive call overides the previous
-		// one: foo -a -b -a hello is equivalent to foo -b -a hello
-		// For values it is not true since we might have several times the same
-		// value.
-		value_iterator* lastOption = NULL;
-		for (CHARTYPE** a = const_cast<CHARTYPE**>(argv),**astop=a+argc;++a!=astop;)
+		occurrence none;
+		none.seen[0] = none.seen[1] = false;
+		none.hasValue[0] = none.hasValue[1] = false;
+		occurrences.assign(slots_.size(), none);
+		bool isOk = true;
+		bool unused = false;
+		bool helpSeen = false;
+		bool minusActive = true;
+		size_t values = 0;
+		size_t consumedValues = 0;
+
+		// Tokenize as argstream::parse() does, resolving each option name
+		// as soon as it is read. last is the option a following value is
+		// linked to.
+		occurrence* last = NULL;
+		int lastName = 0;
+		auto resolve = [&](const TSTRVIEW<CHARTYPE>& name)
+		{
+			if ((name.size() == 1 && name[0] == 'h') ||
+				(name.size() == 4 && name[0] == 'h' && name[1] == 'e' && name[2] == 'l' && name[3] == 'p'))
+			{
+				helpSeen = true;
+			}
+			bucket b;
+			if (lookup(name, b))
+			{
+				occurrence& o = occurrences[b.slot];
+				o.seen[b.name] = true;
+				o.hasValue[b.name] = false;
+				last = &o;
+				lastName = b.name;
+			}
+			else
+			{
+				unused = true;
+				last = NULL;
+			}
+		};
+		for (int i = 1; i < argc; ++i)
 		{
-			typename TSTR<CHARTYPE>::type s(*a);
-			if (minusActive_ && s[0] == '-')
+			TSTRVIEW<CHARTYPE> a(argv[i]);
+			if (minusActive && !a.empty() && a[0] == '-')
 			{
-				if (s.size() > 1 && s[1] == '-')
+				if (a.size() > 1 && a[1] == '-')
 				{
-					if (s.size() == 2)
+					if (a.size() == 2)
 					{
-						minusActive_ = false;
+						minusActive = false;
 						continue;
 					}
-					lastOption = &(options_[s.substr(2)] = values_.end());
+					resolve(a.substr(2));
 				}
 				else
 				{
-					if (s.size() > 1)
+					if (a.size() > 1)
 					{
-						// Parse all _TCHARs, if it is a minus we have an error
-						for (typename TSTR<CHARTYPE>::type::const_iterator cter = s.begin();
-							++cter != s.end();)
+						for (size_t c = 1; c < a.size(); ++c)
 						{
-							if (*cter == '-')
+							if (a[c] == '-')
 							{
-								isOk_ = false;
-								typename TSTRSTREAM<CHARTYPE>::O os;
-								os<<TSTR<CHARTYPE>::ToString("- in the middle of a switch ")<<a;
-								errors_.push_back(os.str());
+								isOk = false;
+								if (errors)
+								{
+									typename TSTRSTREAM<CHARTYPE>::O os;
+									os<<ARGSTREAM_LITERAL(CHARTYPE, "- in the middle of a switch ")<<a;
+									errors->push_back(os.str());
+								}
 								break;
 							}
-							lastOption = &(options_[typename TSTR<CHARTYPE>::type(1,*cter)] = values_.end());
+							resolve(a.substr(c, 1));
 						}
 					}
 					else
 					{
-						isOk_ = false;
-						errors_.push_back(TSTR<CHARTYPE>::ToString("Invalid argument -"));
+						isOk = false;
+						if (errors) errors->push_back(ARGSTREAM_LITERAL(CHARTYPE, "Invalid argument -"));
 						break;
 					}
 				}
 			}
 			else
 			{
-				values_.push_back(s);
-				if (lastOption != NULL)
+				++values;
+				if (last != NULL)
 				{
-					*lastOption = --values_.end();
+					last->hasValue[lastName] = true;
+					last->value[lastName] = a;
 				}
-				lastOption = NULL;
+				last = NULL;
 			}
 		}
-#ifdef ARGSTREAM_DEBUG
-		for (std::map<_TSTRING,value_iterator>::const_iterator
-			iter = options_.begin();iter != options_.end();++iter)
+
+		// Bind the slots in declaration order.
+		for (size_t i = 0; i < slots_.size(); ++i)
 		{
-			TSTREAM<CHARTYPE>::COUT << TSTR<CHARTYPE>::ToString("DEBUG: option ") << iter->first;
-			if (iter->second != values_.end())
+			const slot& sl = slots_[i];
+			const occurrence& o = occurrences[i];
+			int n = o.seen[0] ? 0 : 1;
+			if (o.seen[0] && o.seen[1])
+			{
+				unused = true; // The long name is left over
+			}
+			if (sl.kind == SLOT_OPTION)
+			{
+				sink.set(i, o.seen[n]);
+				continue;
+			}
+			sink.reset(i);
+			if (o.seen[n])
+			{
+				const typename TSTR<CHARTYPE>::type& name = n == 0 ? sl.shortName : sl.longName;
+				if (o.hasValue[n])
+				{
+					++consumedValues;
+					if (!sink.assign(i, o.value[n]))
+					{
+						isOk = false;
+						if (errors)
+						{
+							typename TSTRSTREAM<CHARTYPE>::O os;
+							os	<< ARGSTREAM_LITERAL(CHARTYPE, "Invalid value ") << o.value[n]
+								<< ARGSTREAM_LITERAL(CHARTYPE, " following switch ") << name;
+							errors->push_back(os.str());
+						}
+					}
+				}
+				else
+				{
+					isOk = false;
+					if (errors)
+					{
+						typename TSTRSTREAM<CHARTYPE>::O os;
+						os	<< ARGSTREAM_LITERAL(CHARTYPE, "No value following switch ") << name
+							<< ARGSTREAM_LITERAL(CHARTYPE, " on command line");
+						errors->push_back(os.str());
+					}
+				}
+			}
+			else if (sl.mandatory)
 			{
-				TSTREAM<CHARTYPE>::COUT << TSTR<CHARTYPE>::ToString(" -> ") << *(iter->second);
+				isOk = false;
+				if (errors)
+				{
+					typename TSTRSTREAM<CHARTYPE>::O os;
+					os<< ARGSTREAM_LITERAL(CHARTYPE, "Mandatory parameter ");
+					if (!sl.shortName.empty()) os<<'-'<<sl.shortName;
+					if (!sl.longName.empty())
+					{
+						if (!sl.shortName.empty()) os<<'/';
+						os << ARGSTREAM_LITERAL(CHARTYPE, "--") << sl.longName;
+					}
+					os<< ARGSTREAM_LITERAL(CHARTYPE, " missing");
+					errors->push_back(os.str());
+				}
 			}
-			std::cout<<std::endl;
 		}
-		for (std::list<_TSTRING>::const_iterator
-			iter = values_.begin();iter != values_.end();++iter)
+
+		if (helpSeen && hasOption_)
 		{
-			TSTREAM<CHARTYPE>::COUT << TSTR<CHARTYPE>::ToString("DEBUG: value ") << *iter << std::endl;
+			return RESULT_OF_PARSE::PARSED_ERR_HELP_REQUESTED;
 		}
-#endif // ARGSTREAM_DEBUG
+		if (!isOk)
+		{
+			return RESULT_OF_PARSE::PARSED_ERR_OTHER;
+		}
+		if (!ignoreUnused && (unused || consumedValues < values))
+		{
+			return RESULT_OF_PARSE::PARSED_ERR_UNUSED_PARAMETER;
+		}
+		return RESULT_OF_PARSE::PARSED_OK;
+	}
+
+	template<typename CHARTYPE, typename T>
+	inline schema<CHARTYPE>&
+	operator >>(schema<CHARTYPE>& s, ValueHolder<CHARTYPE, T> const& v)
+	{
+		typename schema<CHARTYPE>::slot sl;
+		sl.kind = schema<CHARTYPE>::SLOT_VALUE;
+		sl.shortName = v.shortName_;
+		sl.longName = v.longName_.str();
+		sl.mandatory = v.mandatory_;
+		sl.option = NULL;
+		sl.binding.reset(new ValueBinding<CHARTYPE, T>(v.value_, v.initialValue_));
+		s.add(sl);
+		return s;
 	}
 
 	template<typename CHARTYPE>
-	inline bool
-	argstream<CHARTYPE>::isOk() const
+	inline schema<CHARTYPE>&
+	operator >>(schema<CHARTYPE>& s, OptionHolder<CHARTYPE> const& v)
 	{
-		return isOk_;
+		typename schema<CHARTYPE>::slot sl;
+		sl.kind = schema<CHARTYPE>::SLOT_OPTION;
+		sl.shortName = v.shortName_;
+		sl.longName = v.longName_.str();
+		sl.mandatory = false;
+		sl.option = v.value_;
+		s.add(sl);
+		return s;
+	}
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Interface of batch<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+	/**
+		Parse many command lines against one schema. Instead of one argstream
+		per command line, the results are stored by column: one vector per
+		declared slot, with one row per command line, plus the result of
+		each command line. The variables bound by the holders of the schema
+		are not modified.
+
+		A row holds the initial value of the variable when the parameter is
+		absent from its command line. Options, and parameters of type bool,
+		are stored as unsigned char (0 or 1).
+
+		The command lines are either argc/argv pairs or flat strings, which
+		are split in a buffer reused from one line to the next.
+	*/
+	template<typename CHARTYPE>
+	class batch
+	{
+	public:
+		typedef std::pair<int, CHARTYPE const* const*> argv_type;
+
+		/**
+			Command line strings are split with the quoting rules of mode.
+		*/
+		inline explicit batch(
+			const schema<CHARTYPE>& s,
+			bool ignoreUnused = false,
+			SPLIT_MODE mode = SPLIT_NATIVE);
+
+		batch<CHARTYPE>(const batch<CHARTYPE>&) = delete;
+		batch<CHARTYPE>& operator=(const batch<CHARTYPE>&) = delete;
+
+		/**
+			Parse one more command line.
+
+			@return The result of the command line.
+		*/
+		inline RESULT_OF_PARSE append(int argc, CHARTYPE const* const argv[]);
+		inline RESULT_OF_PARSE append(const argv_type& line);
+		inline RESULT_OF_PARSE append(const CHARTYPE* c);
+		inline RESULT_OF_PARSE append(const typename TSTR<CHARTYPE>::type& c);
+
+		/**
+			Parse a range of command lines, each element is an argv_type, a
+			CHARTYPE pointer or a string.
+		*/
+		template<typename ITERATOR>
+		inline void parse(ITERATOR first, ITERATOR last);
+
+#ifdef ARGSTREAM_THREADS
+		/**
+			Parse a range of command lines with several threads.
+
+			The range is cut in chunks of lines which are spread evenly
+			among the workers; a worker which runs out of chunks steals
+			from the end of the others' queues. Each worker has its own
+			arena (split buffer, argv and parse scratch), the schema is only
+			read, and every row is written by exactly one worker. The
+			elements of the range must stay alive and unmodified during the
+			call.
+
+			@param first Random access iterator on the first command line.
+			@param last Iterator past the last command line.
+			@param threads Number of workers, 0 for one per hardware thread.
+		*/
+		template<typename ITERATOR>
+		inline void parse(ITERATOR first, ITERATOR last, unsigned int threads);
+#endif
+
+		inline void reserve(size_t rows);
+		inline void clear();
+
+		/**
+			Number of parsed command lines.
+		*/
+		inline size_t size() const;
+		inline RESULT_OF_PARSE result(size_t row) const;
+		inline const std::vector<RESULT_OF_PARSE>& results() const;
+
+		/**
+			Values of a slot, T is the type of the variable given to
+			parameter(), or bool for an option.
+
+			@param slot Index of the slot in declaration order.
+		*/
+		template<typename T>
+		inline const std::vector<typename ColumnType<T>::type>& column(size_t slot) const;
+
+		/**
+			Values of the slot declared with the given short or long name.
+		*/
+		template<typename T>
+		inline const std::vector<typename ColumnType<T>::type>& column(const TSTRVIEW<CHARTYPE>& name) const;
+	private:
+		/**
+			Scratch memory of one worker, reused from one line to the next.
+		*/
+		struct arena
+		{
+			std::vector<CHARTYPE> buffer;
+			std::vector<const CHARTYPE*> argv;
+			std::vector<typename schema<CHARTYPE>::occurrence> occurrences;
+		};
+
+#ifdef ARGSTREAM_THREADS
+		/**
+			Chunks of lines owned by a worker. The owner takes them from the
+			front, thieves from the back.
+		*/
+		struct work_queue
+		{
+			std::mutex lock;
+			size_t front;
+			size_t back;
+		};
+
+		static const size_t CHUNK_SIZE = 64;
+		static inline bool take(std::vector<work_queue>& queues, size_t worker, size_t& chunk);
+#endif
+
+		inline size_t grow(size_t rows);
+		inline RESULT_OF_PARSE parseRow(size_t row, const argv_type& line, arena& a);
+		inline RESULT_OF_PARSE parseRow(size_t row, const CHARTYPE* c, arena& a);
+		inline RESULT_OF_PARSE parseRow(size_t row, const typename TSTR<CHARTYPE>::type& c, arena& a);
+
+		struct column_sink
+		{
+			batch<CHARTYPE>& b;
+			size_t row;
+			inline void reset(size_t) const
+			{
+			}
+			inline bool assign(size_t i, const TSTRVIEW<CHARTYPE>& v) const
+			{
+				return b.columns_[i]->assign(row, v);
+			}
+			inline void set(size_t i, bool v) const
+			{
+				b.columns_[i]->set(row, v);
+			}
+		};
+
+		const schema<CHARTYPE>& schema_;
+		bool ignoreUnused_;
+		SPLIT_MODE mode_;
+		std::vector<std::unique_ptr<SchemaColumn<CHARTYPE> > > columns_;
+		std::vector<RESULT_OF_PARSE> results_;
+		arena arena_;
+	};
+
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	// Implementation of batch<CHARTYPE>
+	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+	template<typename CHARTYPE>
+	inline batch<CHARTYPE>::batch(const schema<CHARTYPE>& s, bool ignoreUnused, SPLIT_MODE mode)
+		: schema_(s),
+		ignoreUnused_(ignoreUnused),
+		mode_(mode)
+	{
+		// The workers of parallel parsing only read the hash
+		s.compile();
+		for (size_t i = 0; i < s.slots_.size(); ++i)
+		{
+			if (s.slots_[i].kind == schema<CHARTYPE>::SLOT_OPTION)
+			{
+				columns_.push_back(std::unique_ptr<SchemaColumn<CHARTYPE> >(new OptionColumn<CHARTYPE>()));
+			}
+			else
+			{
+				columns_.push_back(std::unique_ptr<SchemaColumn<CHARTYPE> >(s.slots_[i].binding->column()));
+			}
+		}
+	}
+
+#ifdef ARGSTREAM_THREADS
+	template<typename CHARTYPE>
+	const size_t batch<CHARTYPE>::CHUNK_SIZE;
+#endif
+
+	template<typename CHARTYPE>
+	inline size_t
+	batch<CHARTYPE>::grow(size_t rows)
+	{
+		size_t row = results_.size();
+		results_.resize(row + rows, RESULT_OF_PARSE::PARSED_OK);
+		for (size_t i = 0; i < columns_.size(); ++i)
+		{
+			columns_[i]->resize(row + rows);
+		}
+		return row;
+	}
+
+	template<typename CHARTYPE>
+	inline RESULT_OF_PARSE
+	batch<CHARTYPE>::parseRow(size_t row, const argv_type& line, arena& a)
+	{
+		column_sink sink = { *this, row };
+		results_[row] = schema_.parse(line.first, line.second, NULL, ignoreUnused_, sink, a.occurrences);
+		return results_[row];
+	}
+
+	template<typename CHARTYPE>
+	inline RESULT_OF_PARSE
+	batch<CHARTYPE>::parseRow(size_t row, const CHARTYPE* c, arena& a)
+	{
+		Tokenizer<CHARTYPE>::split(c, a.buffer, a.argv, mode_);
+		return parseRow(row, argv_type(static_cast<int>(a.argv.size()), &a.argv[0]), a);
+	}
+
+	template<typename CHARTYPE>
+	inline RESULT_OF_PARSE
+	batch<CHARTYPE>::parseRow(size_t row, const typename TSTR<CHARTYPE>::type& c, arena& a)
+	{
+		return parseRow(row, c.c_str(), a);
+	}
+
+	template<typename CHARTYPE>
+	inline RESULT_OF_PARSE
+	batch<CHARTYPE>::append(int argc, CHARTYPE const* const argv[])
+	{
+		return parseRow(grow(1), argv_type(argc, argv), arena_);
+	}
+
+	template<typename CHARTYPE>
+	inline RESULT_OF_PARSE
+	batch<CHARTYPE>::append(const argv_type& line)
+	{
+		return parseRow(grow(1), line, arena_);
+	}
+
+	template<typename CHARTYPE>
+	inline RESULT_OF_PARSE
+	batch<CHARTYPE>::append(const CHARTYPE* c)
+	{
+		return parseRow(grow(1), c, arena_);
+	}
+
+	template<typename CHARTYPE>
+	inline RESULT_OF_PARSE
+	batch<CHARTYPE>::append(const typename TSTR<CHARTYPE>::type& c)
+	{
+		return parseRow(grow(1), c, arena_);
+	}
+
+	template<typename CHARTYPE>
+	template<typename ITERATOR>
+	inline void
+	batch<CHARTYPE>::parse(ITERATOR first, ITERATOR last)
+	{
+		for (; first != last; ++first)
+		{
+			append(*first);
+		}
 	}
 
+#ifdef ARGSTREAM_THREADS
 	template<typename CHARTYPE>
 	inline bool
-	argstream<CHARTYPE>::helpRequested() const
+	batch<CHARTYPE>::take(std::vector<work_queue>& queues, size_t worker, size_t& chunk)
 	{
-		return helpRequested_;
+		{
+			work_queue& own = queues[worker];
+			std::lock_guard<std::mutex> guard(own.lock);
+			if (own.front < own.back)
+			{
+				chunk = own.front++;
+				return true;
+			}
+		}
+		for (size_t i = 1; i < queues.size(); ++i)
+		{
+			work_queue& victim = queues[(worker + i) % queues.size()];
+			std::lock_guard<std::mutex> guard(victim.lock);
+			if (victim.front < victim.back)
+			{
+				chunk = --victim.back;
+				return true;
+			}
+		}
+		return false;
 	}
 
 	template<typename CHARTYPE>
-	inline typename TSTR<CHARTYPE>::type
-	argstream<CHARTYPE>::usage() const
+	template<typename ITERATOR>
+	inline void
+	batch<CHARTYPE>::parse(ITERATOR first, ITERATOR last, unsigned int threads)
 	{
-		typename TSTRSTREAM<CHARTYPE>::O os;
-		if (copyright_.size())
+		size_t n = static_cast<size_t>(last - first);
+		size_t chunks = (n + CHUNK_SIZE - 1) / CHUNK_SIZE;
+		if (threads == 0)
 		{
-			os << copyright_ << std::endl << std:: endl;
+			threads = std::thread::hardware_concurrency();
 		}
-		os<<TSTR<CHARTYPE>::ToString("Usage: ")<<progName_<<cmdLine_<<std::endl;
-		unsigned int lmax = 0;
-		for (typename std::deque<help_entry>::const_iterator iter = argHelps_.begin();
-                     iter != argHelps_.end();++iter)
+		if (threads > chunks)
 		{
-			if (lmax<iter->first.size()) lmax = iter->first.size();
+			threads = static_cast<unsigned int>(chunks);
 		}
-		for (typename std::deque<help_entry>::const_iterator iter = argHelps_.begin();
-                     iter != argHelps_.end();++iter)
+		if (threads <= 1)
 		{
-			os << '\t' << iter->first << TSTR<CHARTYPE>::type(lmax-iter->first.size(),' ')
-				<< TSTR<CHARTYPE>::ToString(" : ") << iter->second << std::endl;
+			parse(first, last);
+			return;
 		}
 
-		// Append the examples
-		if (argExamples_.size())
+		// All the rows are allocated up front, the workers only fill them.
+		size_t base = grow(n);
+		std::vector<work_queue> queues(threads);
+		std::vector<arena> arenas(threads);
+		for (size_t w = 0; w < threads; ++w)
+		{
+			queues[w].front = chunks * w / threads;
+			queues[w].back = chunks * (w + 1) / threads;
+		}
+		auto work = [&](size_t w)
 		{
-			int i = 1;
-			for (auto example:argExamples_)
+			size_t chunk;
+			while (take(queues, w, chunk))
 			{
-				os << std::endl
-					<< TSTR<CHARTYPE>::ToString("----------") << std::endl
-					<< TSTR<CHARTYPE>::ToString("Example ") << i++ << std::endl
-					<< TSTR<CHARTYPE>::ToString("----------") << std::endl
-					<< TSTR<CHARTYPE>::ToString("Command: ") << std::endl
-					<< TSTR<CHARTYPE>::ToString("\t") << example.first << std::endl << std::endl
-					<< TSTR<CHARTYPE>::ToString("Description:") << std::endl
-					<< TSTR<CHARTYPE>::ToString("\t") << example.second << std::endl;
+				size_t end = (chunk + 1) * CHUNK_SIZE < n ? (chunk + 1) * CHUNK_SIZE : n;
+				for (size_t i = chunk * CHUNK_SIZE; i < end; ++i)
+				{
+					parseRow(base + i, *(first + i), arenas[w]);
+				}
 			}
+		};
+		std::vector<std::thread> workers;
+		for (size_t w = 1; w < threads; ++w)
+		{
+			workers.push_back(std::thread(work, w));
+		}
+		work(0);
+		for (size_t w = 0; w < workers.size(); ++w)
+		{
+			workers[w].join();
+		}
+	}
+#endif
+
+	template<typename CHARTYPE>
+	inline void
+	batch<CHARTYPE>::reserve(size_t rows)
+	{
+		results_.reserve(rows);
+		for (size_t i = 0; i < columns_.size(); ++i)
+		{
+			columns_[i]->reserve(rows);
+		}
+	}
+
+	template<typename CHARTYPE>
+	inline void
+	batch<CHARTYPE>::clear()
+	{
+		results_.clear();
+		for (size_t i = 0; i < columns_.size(); ++i)
+		{
+			columns_[i]->resize(0);
 		}
-		return os.str();
 	}
 
 	template<typename CHARTYPE>
-	inline typename TSTR<CHARTYPE>::type
-	argstream<CHARTYPE>::errorLog() const
+	inline size_t
+	batch<CHARTYPE>::size() const
 	{
-		typename TSTR<CHARTYPE>::type s;
-		for(typename std::deque<typename TSTR<CHARTYPE>::type>::const_iterator iter = errors_.begin();
-                    iter != errors_.end();++iter)
-		{
-			s += *iter;
-			s += '\n';
-		}
-		return s;
+		return results_.size();
 	}
 
 	template<typename CHARTYPE>
 	inline RESULT_OF_PARSE
-	argstream<CHARTYPE>::defaultErrorHandling(bool ignoreUnused) const
+	batch<CHARTYPE>::result(size_t row) const
 	{
-		if (helpRequested_)
-		{
-			return RESULT_OF_PARSE::PARSED_ERR_HELP_REQUESTED;
-		}
-		if (!isOk_)
-		{
-			return RESULT_OF_PARSE::PARSED_ERR_OTHER;
-		}
-		if (!ignoreUnused &&
-			(!values_.empty() || !options_.empty()))
-		{
-			return RESULT_OF_PARSE::PARSED_ERR_UNUSED_PARAMETER;
-		}
-		return RESULT_OF_PARSE::PARSED_OK;
+		return results_[row];
+	}
+
+	template<typename CHARTYPE>
+	inline const std::vector<RESULT_OF_PARSE>&
+	batch<CHARTYPE>::results() const
+	{
+		return results_;
+	}
+
+	template<typename CHARTYPE>
+	template<typename T>
+	inline const std::vector<typename ColumnType<T>::type>&
+	batch<CHARTYPE>::column(size_t slot) const
+	{
+		const ValueColumn<CHARTYPE, T>* c =
+			dynamic_cast<const ValueColumn<CHARTYPE, T>*>(columns_[slot].get());
+		assert(c != NULL); // T is not the type of the slot
+		return c->values();
+	}
+
+	template<typename CHARTYPE>
+	template<typename T>
+	inline const std::vector<typename ColumnType<T>::type>&
+	batch<CHARTYPE>::column(const TSTRVIEW<CHARTYPE>& name) const
+	{
+		size_t slot = schema_.find(name);
+		assert(slot != schema<CHARTYPE>::npos); // No such name in the schema
+		return column<T>(slot);
 	}
 
 	//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -1054,13 +5719,13 @@ namespace argstream
 		const CHARTYPE* l,
 		T& b,
 		const CHARTYPE* desc,
-		bool mandatory)
+		bool mandatory,
+		const CHARTYPE* env)
 	{
-		return ValueHolder<CHARTYPE, T>(s,l,b,desc,mandatory);
+		return ValueHolder<CHARTYPE, T>(s,l,b,desc,mandatory,env);
 	}
 
-	/*
-	template<typename CHARTYPE, typename T, typename O>
+	template<typename T, typename CHARTYPE, typename O>
 	inline ValuesHolder<CHARTYPE, T, O>
 	values(
 		const O& o,
@@ -1069,7 +5734,38 @@ namespace argstream
 	{
 		return ValuesHolder<CHARTYPE, T, O>(o, desc, len);
 	}
-	*/
+
+	template<typename T, typename CHARTYPE, typename A>
+	inline ValuesHolder<CHARTYPE, T, std::vector<T, A>*>
+	values(
+		std::vector<T, A>& v,
+		const CHARTYPE* desc,
+		int len)
+	{
+		return ValuesHolder<CHARTYPE, T, std::vector<T, A>*>(&v, desc, len);
+	}
+
+	template<typename T, typename CHARTYPE, typename O>
+	inline ValuesHolder<CHARTYPE, T, O>
+	values(
+		NulReader<CHARTYPE>& in,
+		const O& o,
+		const CHARTYPE* desc,
+		int len)
+	{
+		return ValuesHolder<CHARTYPE, T, O>(o, desc, len, &in);
+	}
+
+	template<typename T, typename CHARTYPE, typename A>
+	inline ValuesHolder<CHARTYPE, T, std::vector<T, A>*>
+	values(
+		NulReader<CHARTYPE>& in,
+		std::vector<T, A>& v,
+		const CHARTYPE* desc,
+		int len)
+	{
+		return ValuesHolder<CHARTYPE, T, std::vector<T, A>*>(&v, desc, len, &in);
+	}
 
 	template<typename CHARTYPE>
 	inline OptionHolder<CHARTYPE>
@@ -1077,31 +5773,17 @@ namespace argstream
 		CHARTYPE s,
 		const CHARTYPE* l,
 		bool& b,
-		const CHARTYPE* desc)
+		const CHARTYPE* desc,
+		const CHARTYPE* env)
 	{
-		return OptionHolder<CHARTYPE>(s, l, b, desc);
+		return OptionHolder<CHARTYPE>(s, l, b, desc, env);
 	}
 	template<typename CHARTYPE>
 	inline OptionHolder<CHARTYPE>
 	help()
 	{
-		assert(false); // Should not run the default path.
-		return;
-	}
-	template<>
-	inline OptionHolder<wchar_t>
-	help()
-	{
-		return OptionHolder<wchar_t>(L'h', L"Help", L"Display this help");
-	}
-
-	template<>
-	inline OptionHolder<char>
-	help()
-	{
-		return OptionHolder<char>('h', "Help", "Display this help");
+		return OptionHolder<CHARTYPE>('h', ARGSTREAM_LITERAL(CHARTYPE, "Help"), ARGSTREAM_LITERAL(CHARTYPE, "Display this help"));
 	}
-
 	template<typename CHARTYPE>
 	inline ExampleHolder<CHARTYPE>
 	example(const CHARTYPE* cmdline, const CHARTYPE* desc)
@@ -1116,87 +5798,124 @@ namespace argstream
 		return CopyrightHolder<CHARTYPE>(copyright);
 	}
 
-	template<typename CHARTYPE, typename T>
-	inline argstream<CHARTYPE>&
-	operator >>(argstream<CHARTYPE>& s, ValueHolder<CHARTYPE, T> const& v)
+	template<typename CHARTYPE>
+	template<typename T>
+	inline void
+	argstream<CHARTYPE>::declareHolder(const ValueHolder<CHARTYPE, T>& v)
 	{
-		// Search in the options if there is any such option defined either with a
-		// short name or a long name. If both are found, only the last one is
-		// used.
 #ifdef ARGSTREAM_DEBUG
-		TSTRSTREAM<CHARTYPE>::COUT << TSTR<CHARTYPE>::ToString("DEBUG: searching ")
-			<< v.shortName_<<L" "<<v.longName_<<std::endl;
+		debugStream(CHARTYPE()) << ARGSTREAM_LITERAL(CHARTYPE, "DEBUG: searching ")
+			<< v.shortName_<<' '<<v.longName_<<std::endl;
 #endif
-		typename argstream<CHARTYPE>::help_entry entry(v.name(), v.description());
-		s.argHelps_.push_back(entry);
-		if (v.mandatory_)
+		addHelp(HELP_VALUE, v.mandatory_, v.shortName_, v.longName_, v.description_);
+		helps_.back().env = v.env_;
+	}
+
+	template<typename CHARTYPE>
+	template<typename T>
+	inline void
+	argstream<CHARTYPE>::bindHolder(const ValueHolder<CHARTYPE, T>& v, size_t option, size_t help)
+	{
+		if (option != npos)
 		{
-			if (!v.shortName_.empty())
+			size_t value = valueOf(option);
+			if (value != npos)
 			{
-				s.cmdLine_ += TSTR<CHARTYPE>::ToString(" -");
-				s.cmdLine_ += v.shortName_;
+#ifdef ARGSTREAM_DEBUG
+				debugStream(CHARTYPE()) << ARGSTREAM_LITERAL(CHARTYPE, "DEBUG: found value ")
+					<< tokens_[value].text<<std::endl;
+#endif
+				ValueParser<CHARTYPE, T> p;
+				if (!p(tokens_[value].text, *(v.value_)))
+				{
+					isOk_ = false;
+					addError(ERR_INVALID_VALUE, value, help);
+				}
+				// The option and its associated value are consumed. Other options
+				// which might have this associated value too see it as consumed
+				// through valueOf().
+				consume(value);
+				consume(option);
 			}
 			else
 			{
-				s.cmdLine_ += TSTR<CHARTYPE>::ToString(" --");
-				s.cmdLine_ += v.longName_;
+				isOk_ = false;
+				addError(ERR_NO_VALUE, option, help);
 			}
-			s.cmdLine_ += TSTR<CHARTYPE>::ToString(" value");
 		}
-		else
+		else if (const TSTRVIEW<CHARTYPE>* value = findEnvironment(v.env_))
 		{
-			if (!v.shortName_.empty())
-			{
-				s.cmdLine_ += TSTR<CHARTYPE>::ToString(" [-");
-				s.cmdLine_ += v.shortName_;
-			}
-			else
+			ValueParser<CHARTYPE, T> p;
+			if (!p(*value, *(v.value_)))
 			{
-				s.cmdLine_ += TSTR<CHARTYPE>::ToString(" [--");
-				s.cmdLine_ += v.longName_;
+				isOk_ = false;
+				addError(ERR_INVALID_VALUE, 0, npos, help, *value);
 			}
-			s.cmdLine_ += TSTR<CHARTYPE>::ToString(" value]");
 		}
-		typename std::map<typename TSTR<CHARTYPE>::type, typename argstream<CHARTYPE>::value_iterator>::iterator iter =
-			s.options_.find(v.shortName_);
-		if (iter == s.options_.end())
+		else
 		{
-			iter = s.options_.find(v.longName_);
+			if (v.mandatory_)
+			{
+				isOk_ = false;
+				addError(ERR_MISSING_MANDATORY, npos, help);
+			}
 		}
-		if (iter != s.options_.end())
+	}
+
+	template<typename CHARTYPE, typename T>
+	inline argstream<CHARTYPE>&
+	operator >>(argstream<CHARTYPE>& s, ValueHolder<CHARTYPE, T> const& v)
+	{
+		// Search in the options if there is any such option defined either with a
+		// short name or a long name. If both are found, only the last one is
+		// used.
+		ARGSTREAM_PHASE(CHARTYPE, PHASE_BIND, s.resource_,
+			v.longName_.empty() ? TSTRVIEW<CHARTYPE>(v.shortName_) : TSTRVIEW<CHARTYPE>(v.longName_));
+		s.declareHolder(v);
+		size_t option = s.findHolderOption(v.shortName_, v.longName_);
+		s.bindHolder(v, option, s.helps_.size() - 1);
+		return s;
+	}
+
+	template<typename CHARTYPE, typename T>
+	inline argstream<CHARTYPE>&
+	operator >>(argstream<CHARTYPE>& s, ValueHolder<CHARTYPE, bool> const& v)
+	{
+		// Search in the options if there is any such option defined either with a
+		// short name or a long name. If both are found, only the last one is
+		// used.
+		ARGSTREAM_PHASE(CHARTYPE, PHASE_BIND, s.resource_,
+			v.longName_.empty() ? TSTRVIEW<CHARTYPE>(v.shortName_) : TSTRVIEW<CHARTYPE>(v.longName_));
+#ifdef ARGSTREAM_DEBUG
+		debugStream(CHARTYPE()) << ARGSTREAM_LITERAL(CHARTYPE, "DEBUG: searching ")
+			<< v.shortName_<<' '<<v.longName_<<std::endl;
+#endif
+		s.addHelp(HELP_SWITCH, v.mandatory_, v.shortName_, v.longName_, v.description_);
+		size_t option = s.findHolderOption(v.shortName_, v.longName_);
+		if (option != argstream<CHARTYPE>::npos)
 		{
-			if (iter->second != s.values_.end())
+			size_t value = s.valueOf(option);
+			if (value != argstream<CHARTYPE>::npos)
 			{
 #ifdef ARGSTREAM_DEBUG
-				TSTRSTREAM<CHARTYPE>::COUT << TSTR<CHARTYPE>::ToString("DEBUG: found value ")
-					<< *(iter->second)<<std::endl;
+				debugStream(CHARTYPE()) << ARGSTREAM_LITERAL(CHARTYPE, "DEBUG: found value ")
+					<< s.tokens_[value].text<<std::endl;
 #endif
-				ValueParser<CHARTYPE, T> p;
-				*(v.value_) = p(*(iter->second));
-				// The option and its associated value are removed, the subtle thing
-				// is that someother options might have this associated value too,
-				// which we must invalidate.
-				s.values_.erase(iter->second);
-
-				/* Disabled by Levski Weng, if one item of the values_ is removed, you cannot compare them any more.
-				for (std::map<typename TSTR<CHARTYPE>::type, typename argstream<CHARTYPE>::value_iterator>::iterator
-					jter = s.options_.begin();jter != s.options_.end();++jter)
+				ValueParser<CHARTYPE, bool> p;
+				if (!p(s.tokens_[value].text, *(v.value_)))
 				{
-					if (jter->second == iter->second)
-					{
-						jter->second = s.values_.end();
-					}
+					s.isOk_ = false;
+					s.addError(ERR_INVALID_VALUE, value, s.helps_.size() - 1);
 				}
-				*/
-				s.options_.erase(iter);
+				// Only the option is consumed, the value is left on the command
+				// line.
+				// Modified by Levski Weng
+				s.consume(option);
+				s.consumeSetting(option);
 			}
 			else
 			{
-				s.isOk_ = false;
-				typename TSTRSTREAM<CHARTYPE>::O os;
-				os	<< TSTR<CHARTYPE>::ToString("No value following switch ") << iter->first
-					<< TSTR<CHARTYPE>::ToString(" on command line");
-				s.errors_.push_back(os.str());
+				*(v.value_) = true;
 			}
 		}
 		else
@@ -1204,178 +5923,342 @@ namespace argstream
 			if (v.mandatory_)
 			{
 				s.isOk_ = false;
-				typename TSTRSTREAM<CHARTYPE>::O os;
-				os<< TSTR<CHARTYPE>::ToString("Mandatory parameter ");
-				if (!v.shortName_.empty()) os<<'-'<<v.shortName_;
-				if (!v.longName_.empty())
-				{
-					if (!v.shortName_.empty()) os<<'/';
-					os << TSTR<CHARTYPE>::ToString("--") << v.longName_;
-				}
-				os<< TSTR<CHARTYPE>::ToString(" missing");
-				s.errors_.push_back(os.str());
+				s.addError(ERR_MISSING_MANDATORY, argstream<CHARTYPE>::npos, s.helps_.size() - 1);
 			}
 		}
 		return s;
 	}
 
-	template<typename CHARTYPE, typename T>
-	inline argstream<CHARTYPE>&
-	operator >>(argstream<CHARTYPE>& s, ValueHolder<CHARTYPE, bool> const& v)
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE void
+	argstream<CHARTYPE>::declareHolder(const OptionHolder<CHARTYPE>& v)
 	{
-		// Search in the options if there is any such option defined either with a
-		// short name or a long name. If both are found, only the last one is
-		// used.
 #ifdef ARGSTREAM_DEBUG
-		TSTRSTREAM<CHARTYPE>::COUT << TSTR<CHARTYPE>::ToString("DEBUG: searching ")
-			<< v.shortName_<<L" "<<v.longName_<<std::endl;
+		debugStream(CHARTYPE()) << ARGSTREAM_LITERAL(CHARTYPE, "DEBUG: found value ")
+			<< v.shortName_<<' '<<v.longName_<<std::endl;
 #endif
-		s.argHelps_.push_back(argstream<CHARTYPE>::help_entry(v.name(),v.description()));
-		if (v.mandatory_)
+		addHelp(HELP_OPTION, false, v.shortName_, v.longName_, v.description_);
+		helps_.back().env = v.env_;
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE void
+	argstream<CHARTYPE>::checkHelp()
+	{
+		if (findOption(ARGSTREAM_LITERAL(CHARTYPE, "h"), false) != npos ||
+			findOption(ARGSTREAM_LITERAL(CHARTYPE, "help"), false) != npos )
 		{
-			if (!v.shortName_.empty())
-			{
-				s.cmdLine_ += TSTR<CHARTYPE>::ToString(" -");
-				s.cmdLine_ += v.shortName_;
-			}
-			else
+			helpRequested_ = true;
+		}
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE void
+	argstream<CHARTYPE>::bindHolder(const OptionHolder<CHARTYPE>& v, size_t option, size_t)
+	{
+		if (option != npos)
+		{
+			// If we find counterpart for value holder on command line then the
+			// option is true and if an associated value was found, it is ignored
+			if (v.value_ != NULL)
 			{
-				s.cmdLine_ += TSTR<CHARTYPE>::ToString(" --");
-				s.cmdLine_ += v.longName_;
+				// A setting may say "name = off"
+				*(v.value_) = !isSetting(option) || tokens_[option].value == npos ||
+					isSet(tokens_[tokens_[option].value].text);
 			}
+			// The option only is consumed, with its value for a setting
+			consume(option);
+			consumeSetting(option);
 		}
 		else
 		{
-			if (!v.shortName_.empty())
-			{
-				s.cmdLine_ += TSTR<CHARTYPE>::ToString(" [-");
-				s.cmdLine_ += v.shortName_;
-			}
-			else
+			if (v.value_ != NULL)
 			{
-				s.cmdLine_ += TSTR<CHARTYPE>::ToString(" [--");
-				s.cmdLine_ += v.longName_;
+				const TSTRVIEW<CHARTYPE>* value = findEnvironment(v.env_);
+				*(v.value_) = value != NULL && isSet(*value);
 			}
-			s.cmdLine_ += TSTR<CHARTYPE>::ToString("]");
+		}
+	}
+
+	template<typename CHARTYPE>
+	inline argstream<CHARTYPE>&
+	operator >>(argstream<CHARTYPE>& s, OptionHolder<CHARTYPE> const& v)
+	{
+		// Search in the options if there is any such option defined either with a
+		// short name or a long name. If both are found, only the last one is
+		// used.
+		ARGSTREAM_PHASE(CHARTYPE, PHASE_BIND, s.resource_,
+			v.longName_.empty() ? TSTRVIEW<CHARTYPE>(v.shortName_) : TSTRVIEW<CHARTYPE>(v.longName_));
+		s.declareHolder(v);
+		s.checkHelp();
+		size_t option = s.findHolderOption(v.shortName_, v.longName_);
+		s.bindHolder(v, option, s.helps_.size() - 1);
+		return s;
+	}
 
+	template<typename CHARTYPE>
+	template<typename T, typename O>
+	inline void
+	argstream<CHARTYPE>::declareHolder(const ValuesHolder<CHARTYPE, T, O>& v)
+	{
+		// Each values() is shown with its own letter: a1 ... for the first
+		// one, b1 ... for the next one.
+		addHelp(HELP_VALUES, false, typename TSTR<CHARTYPE>::type(), TSTRVIEW<CHARTYPE>(), v.description_);
+		helps_.back().len = v.len_;
+		helps_.back().letter = valuesLetter_++;
+	}
+
+	template<typename CHARTYPE>
+	template<typename T, typename O>
+	inline void
+	argstream<CHARTYPE>::bindHolder(const ValuesHolder<CHARTYPE, T, O>& v, size_t, size_t help)
+	{
+		// We add as much values as we can, limited to the length specified (if
+		// different of -1)
+		size_t limit = v.len_ < 0 ? npos : static_cast<size_t>(v.len_);
+		if (storeValues<T>(v.value_, limit, help, v.source_) != limit && v.len_ >= 0)
+		{
+			isOk_ = false;
+			addError(ERR_MISSING_VALUES, npos, help);
 		}
-		typename std::map<typename TSTR<CHARTYPE>::type, typename argstream<CHARTYPE>::value_iterator>::iterator iter =
-			s.options_.find(v.shortName_);
-		if (iter == s.options_.end())
+	}
+
+	template<typename CHARTYPE>
+	inline size_t
+	argstream<CHARTYPE>::takeValue()
+	{
+		// The tokens before the cursor are options or consumed values, each
+		// token is visited once by all the values() holders together.
+		while (valueCursor_ < tokens_.size())
 		{
-			iter = s.options_.find(v.longName_);
+			size_t t = valueCursor_++;
+			if (tokens_[t].kind == TOKEN_VALUE && !isConsumed(t))
+			{
+				consume(t);
+				return t;
+			}
 		}
-		if (iter != s.options_.end())
+		return npos;
+	}
+
+	template<typename CHARTYPE>
+	template<typename T, typename O>
+	inline size_t
+	argstream<CHARTYPE>::storeValues(O& o, size_t limit, size_t help, NulReader<CHARTYPE>* source)
+	{
+		ValueParser<CHARTYPE, T> p;
+		T t = T();
+		size_t n = 0;
+		for (; n < limit; ++n)
 		{
-			if (iter->second != s.values_.end())
+			size_t value = takeValue();
+			if (value == npos)
 			{
-#ifdef ARGSTREAM_DEBUG
-				TSTRSTREAM<CHARTYPE>::COUT << TSTR<CHARTYPE>::ToString("DEBUG: found value ")
-					<< *(iter->second)<<std::endl;
-#endif
-				ValueParser<CHARTYPE, T> p;
-				*(v.value_) = p(*(iter->second));
-				// The option and its associated value are removed, the subtle thing
-				// is that someother options might have this associated value too,
-				// which we must invalidate.
-				// Modified by Levski Weng
-				//s.values_.erase(iter->second);
-				for (typename std::map<typename TSTR<CHARTYPE>::type, typename argstream<CHARTYPE>::value_iterator>::iterator
-					jter = s.options_.begin();jter != s.options_.end();++jter)
-				{
-					if (jter->second == iter->second)
-					{
-						jter->second = s.values_.end();
-					}
-				}
-				s.options_.erase(iter);
+				break;
+			}
+			if (p(tokens_[value].text, t))
+			{
+				*o = t;
+				++o;
 			}
 			else
 			{
-				*(v.value_) = true;
+				isOk_ = false;
+				addError(ERR_INVALID_VALUE, value, help);
 			}
 		}
-		else
+		if (source != NULL)
 		{
-			if (v.mandatory_)
+			// Then the records of the reader, each one is parsed and written
+			// before the next one is read.
+			TSTRVIEW<CHARTYPE> record;
+			for (; n < limit && source->next(record); ++n)
 			{
-				s.isOk_ = false;
-				typename TSTRSTREAM<CHARTYPE>::O os;
-				os<< TSTR<CHARTYPE>::ToString("Mandatory parameter ");
-				if (!v.shortName_.empty()) os<<'-'<<v.shortName_;
-				if (!v.longName_.empty())
+				if (p(record, t))
 				{
-					if (!v.shortName_.empty()) os<<'/';
-					os << TSTR<CHARTYPE>::ToString("--") << v.longName_;
+					*o = t;
+					++o;
+				}
+				else
+				{
+					addStreamError(record, help);
 				}
-				os<< TSTR<CHARTYPE>::ToString(" missing");
-				s.errors_.push_back(os.str());
 			}
+			checkStream(*source, help);
 		}
-		return s;
+		return n;
 	}
 
-
 	template<typename CHARTYPE>
-	inline argstream<CHARTYPE>&
-	operator >>(argstream<CHARTYPE>& s, OptionHolder<CHARTYPE> const& v)
+	template<typename T, typename A>
+	inline size_t
+	argstream<CHARTYPE>::storeValues(std::vector<T, A>*& v, size_t limit, size_t help, NulReader<CHARTYPE>* source)
 	{
-		// Search in the options if there is any such option defined either with a
-		// short name or a long name. If both are found, only the last one is
-		// used.
-#ifdef ARGSTREAM_DEBUG
-		TSTRSTREAM<CHARTYPE>::COUT << TSTR<CHARTYPE>::ToString("DEBUG: found value ")
-			<< v.shortName_<<L" "<<v.longName_<<std::endl;
-#endif
-		typename argstream<CHARTYPE>::help_entry entry(v.name(), v.description());
-		s.argHelps_.push_back(entry);
+		// Count the values first so that the vector grows once, then parse
+		// them in place and drop the invalid ones.
+		size_t count = 0;
+		for (size_t i = valueCursor_; i < tokens_.size() && count < limit; ++i)
+		{
+			if (tokens_[i].kind == TOKEN_VALUE && !isConsumed(i))
+			{
+				++count;
+			}
+		}
+		size_t w = v->size();
+		v->resize(w + count);
+		ValueParser<CHARTYPE, T> p;
+		for (size_t n = 0; n < count; ++n)
 		{
-			typename TSTR<CHARTYPE>::type c;
-			if (!v.shortName_.empty())
+			size_t value = takeValue();
+			if (p(tokens_[value].text, (*v)[w]))
 			{
-				c += TSTR<CHARTYPE>::ToString(" [-");
-				c += v.shortName_;
+				++w;
 			}
 			else
 			{
-				c += TSTR<CHARTYPE>::ToString(" [--");
-				c += v.longName_;
+				isOk_ = false;
+				addError(ERR_INVALID_VALUE, value, help);
 			}
-			c += TSTR<CHARTYPE>::ToString("]");
-			s.cmdLine_ = c+s.cmdLine_;
 		}
+		v->resize(w);
+		if (source != NULL)
+		{
+			// The number of records is unknown, they are parsed in place at
+			// the end of the vector.
+			TSTRVIEW<CHARTYPE> record;
+			for (; count < limit && source->next(record); ++count)
+			{
+				v->emplace_back();
+				if (!p(record, v->back()))
+				{
+					v->pop_back();
+					addStreamError(record, help);
+				}
+			}
+			checkStream(*source, help);
+		}
+		return count;
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE void
+	argstream<CHARTYPE>::addStreamError(const TSTRVIEW<CHARTYPE>& record, size_t help)
+	{
+		// The record is overwritten by the next one, the error keeps a copy.
+		isOk_ = false;
+		streamed_.emplace_back(record.data(), record.size(), resource_allocator<CHARTYPE>(resource_));
+		addError(ERR_INVALID_VALUE, npos, npos, help, TSTRVIEW<CHARTYPE>(streamed_.back().data(), streamed_.back().size()));
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE void
+	argstream<CHARTYPE>::checkStream(const NulReader<CHARTYPE>& source, size_t help)
+	{
+		if (source.error() != 0)
+		{
+			isOk_ = false;
+			addError(ERR_READ_VALUES, npos, npos, help, TSTRVIEW<CHARTYPE>());
+		}
+	}
 
-		if (s.options_.find(TSTR<CHARTYPE>::ToString('h')) != s.options_.end() ||
-			s.options_.find(TSTR<CHARTYPE>::ToString("help")) != s.options_.end() )
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE const TSTRVIEW<CHARTYPE>*
+	argstream<CHARTYPE>::findEnvironment(const TSTRVIEW<CHARTYPE>& name)
+	{
+		if (name.empty())
 		{
-			s.helpRequested_ = true;
+			return NULL;
 		}
-		typename std::map<typename TSTR<CHARTYPE>::type, typename argstream<CHARTYPE>::value_iterator>::iterator iter =
-			s.options_.find(v.shortName_);
-		if (iter == s.options_.end())
+		if (!environmentIndexed_)
 		{
-			iter = s.options_.find(v.longName_);
+			indexEnvironment();
 		}
-		if (iter != s.options_.end())
+		size_t mask = environment_.size() - 1;
+		for (size_t h = schema<CHARTYPE>::hash(name, 0) & mask; !environment_[h].name.empty(); h = (h + 1) & mask)
 		{
-			// If we find counterpart for value holder on command line then the
-			// option is true and if an associated value was found, it is ignored
-			if (v.value_ != NULL)
+			if (environment_[h].name == name)
 			{
-				*(v.value_) = true;
+				return &environment_[h].value;
 			}
-			// The option only is removed
-			s.options_.erase(iter);
 		}
-		else
+		return NULL;
+	}
+
+	template<typename CHARTYPE>
+	ARGSTREAM_INLINE void
+	argstream<CHARTYPE>::indexEnvironment()
+	{
+		// environ is copied in one buffer, decoded from UTF-8 for wchar_t,
+		// and hashed once for all the holders of the parser: getenv() would
+		// scan it for each of them.
+		char** env = ARGSTREAM_ENVIRON;
+		environmentIndexed_ = true;
+		size_t count = 0;
+		size_t bytes = 0;
+		for (char** e = env; e != NULL && *e != NULL; ++e)
 		{
-			if (v.value_ != NULL)
+			bytes += std::strlen(*e) + 1;
+			++count;
+		}
+		size_t size = 2;
+		while (size < 2 * count)
+		{
+			size *= 2;
+		}
+		environment_.assign(size, environment_entry());
+		environmentText_.resize(FileText<CHARTYPE>::capacity(bytes));
+		CHARTYPE* w = environmentText_.empty() ? NULL : &environmentText_[0];
+		for (size_t i = 0; i < count; ++i)
+		{
+			CHARTYPE* entry = w;
+			w += FileText<CHARTYPE>::copy(env[i], std::strlen(env[i]), w);
+			CHARTYPE* equal = std::find(entry, w, CHARTYPE('='));
+			if (equal == entry || equal == w)
+			{
+				continue;
+			}
+			environment_entry e;
+			e.name = TSTRVIEW<CHARTYPE>(entry, equal - entry);
+			e.value = TSTRVIEW<CHARTYPE>(equal + 1, w - equal - 1);
+			size_t h = schema<CHARTYPE>::hash(e.name, 0) & (size - 1);
+			while (!environment_[h].name.empty() && environment_[h].name != e.name)
+			{
+				h = (h + 1) & (size - 1);
+			}
+			if (environment_[h].name.empty())
 			{
-				*(v.value_) = false;
+				// The first occurrence of a name is the one getenv() returns
+				environment_[h] = e;
 			}
 		}
+	}
+
+	template<typename CHARTYPE>
+	inline bool
+	argstream<CHARTYPE>::isSet(const TSTRVIEW<CHARTYPE>& value)
+	{
+		return !value.empty() &&
+			value != ARGSTREAM_LITERAL(CHARTYPE, "0") &&
+			value != ARGSTREAM_LITERAL(CHARTYPE, "false") &&
+			value != ARGSTREAM_LITERAL(CHARTYPE, "no") &&
+			value != ARGSTREAM_LITERAL(CHARTYPE, "off");
+	}
+
+	template<typename CHARTYPE, typename T, typename O>
+	inline argstream<CHARTYPE>&
+	operator >>(argstream<CHARTYPE>& s, ValuesHolder<CHARTYPE, T, O> const& v)
+	{
+		ARGSTREAM_PHASE(CHARTYPE, PHASE_BIND, s.resource_, TSTRVIEW<CHARTYPE>());
+		s.declareHolder(v);
+		s.bindHolder(v, argstream<CHARTYPE>::npos, s.helps_.size() - 1);
 		return s;
 	}
 
+#ifdef ARGSTREAM_EXTERN_TEMPLATE
+	// Instantiated by lib/argstream.cpp
+	extern template class argstream<char>;
+	extern template class argstream<wchar_t>;
+#endif
 };
 #endif // ARGSTREAM_H
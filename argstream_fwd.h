@@ -0,0 +1,170 @@
+/**
+	argstream_fwd.h
+	Purpose: Forward declarations of argstream, for the headers which only
+	name argstream<CHARTYPE>, its holders and its enumerations, without
+	including argstream.h and the standard headers it needs.
+	Copyright (C) 2004 Xavier Décoret <Xavier.Decoret@imag.fr>
+	Portions Copyright (C) 2015 Levski Weng <levskiweng@gmail.com>
+
+	@copyright argstream is distributed under the terms of the GNU General
+	Public License, version 2 or later, see argstream.h.
+*/
+
+#ifndef ARGSTREAM_FWD_H
+#define ARGSTREAM_FWD_H
+
+namespace argstream
+{
+	//--------------------------------------------------------------------------
+
+	typedef enum
+    {
+		PARSED_OK = 0,
+		PARSED_ERR_HELP_REQUESTED,
+		PARSED_ERR_UNUSED_PARAMETER,
+		PARSED_ERR_OTHER
+	} RESULT_OF_PARSE;
+
+	typedef enum
+	{
+		TOKEN_OPTION = 0,
+		TOKEN_VALUE,
+		TOKEN_SETTING // Value of a configuration file, never positional
+	} TOKEN_KIND;
+
+	typedef enum
+	{
+		HELP_VALUE = 0, // parameter()
+		HELP_SWITCH,    // Boolean parameter without value
+		HELP_OPTION,    // option() and help()
+		HELP_VALUES     // values()
+	} HELP_KIND;
+
+	typedef enum
+	{
+		ERR_MINUS_IN_SWITCH = 0, // -a-b
+		ERR_LONE_MINUS,          // - alone on the command line
+		ERR_RESPONSE_FILE,       // @file which cannot be read
+		ERR_RESPONSE_FILE_CYCLE, // @file which includes itself
+		ERR_CONFIG_FILE,         // File given to config() which cannot be read
+		ERR_CONFIG_LINE,         // Line of a configuration file without name
+		ERR_NO_VALUE,            // Switch of a parameter() without value
+		ERR_INVALID_VALUE,       // Value not convertible to the type of its holder
+		ERR_MISSING_MANDATORY,   // Mandatory parameter() not given
+		ERR_MISSING_VALUES,      // Less values than the length given to values()
+		ERR_READ_VALUES,         // Read error on the NulReader given to values()
+		ERR_UNUSED               // Argument no holder consumed, see reportUnused()
+	} ERROR_CODE;
+
+	/**
+		Quoting rules used to split a command line string.
+	*/
+	typedef enum
+	{
+		SPLIT_POSIX = 0, // Shell-like: '...', "..." and backslash escapes
+		SPLIT_WINDOWS,   // Same as CommandLineToArgvW
+		SPLIT_NATIVE     // SPLIT_WINDOWS on Windows, SPLIT_POSIX elsewhere
+	} SPLIT_MODE;
+
+	/**
+		Whether the arguments @file are replaced by the arguments the file
+		holds, a response file.
+	*/
+	typedef enum
+	{
+		RESPONSE_FILE_NONE = 0,  // @file is an ordinary value
+		RESPONSE_FILE_EXPAND,    // @file on the command line is expanded
+		RESPONSE_FILE_RECURSIVE  // @file in a response file is expanded too
+	} RESPONSE_FILE_MODE;
+
+	/**
+       Main class to store the argument string.
+	*/
+	template<typename CHARTYPE>
+    class argstream;
+
+	/**
+       Option declarations compiled once and reused to parse many command lines.
+	*/
+	template<typename CHARTYPE>
+    class schema;
+
+	/**
+       Results of many command lines parsed against one schema, by column.
+	*/
+	template<typename CHARTYPE>
+    class batch;
+
+	/**
+       Get the help description.
+	*/
+	template<typename CHARTYPE, typename T>
+    struct description_policy;
+
+	/**
+       The option holder which store the specified option.
+	*/
+	template <typename CHARTYPE>
+    class OptionHolder;
+
+	/**
+       The value holder which stores the value of the speicified argument.
+	*/
+	template<typename CHARTYPE, typename T>
+    class ValueHolder;
+
+	/**
+       The values holder which stores the positional values.
+	*/
+	template<typename CHARTYPE, typename T, typename O>
+    class ValuesHolder;
+
+	/**
+       Reader of the zero terminated arguments given to values().
+	*/
+	template<typename CHARTYPE>
+    class NulReader;
+
+	/**
+       The arguments of the running process, read without main().
+	*/
+	template<typename CHARTYPE>
+    class ProcessArguments;
+
+	/**
+       Convert UTF-8 string to UTF-16 and vice versa.
+	*/
+	template<typename CHARTYPE>
+    struct TSTR;
+
+	/**
+       Template string stream
+	*/
+	template<typename CHARTYPE>
+    struct TSTRSTREAM;
+
+	/**
+       Non-owning reference to a string, usually an argument of argv.
+	*/
+	template<typename CHARTYPE>
+    class TSTRVIEW;
+
+	/**
+       Store the copyright information.
+	*/
+	template <typename CHARTYPE>
+    class CopyrightHolder;
+
+	/**
+       Store the command usage examples.
+	*/
+	template <typename CHARTYPE>
+    class ExampleHolder;
+
+	/**
+       Source of the memory of an argstream.
+	*/
+	class memory_resource;
+	//--------------------------------------------------------------------------
+};
+#endif // ARGSTREAM_FWD_H
@@ -0,0 +1,780 @@
+/**
+	asbench.cpp
+	Purpose: Benchmarks of argstream. Every case runs for char and wchar_t
+	and reports the time, the heap allocations and the allocated bytes per
+	operation. The results can be written as JSON to gate regressions. The
+	utf8/ cases compare the transcoder of argstream, scalar and with SSE2,
+	with std::wstring_convert.
+
+	Usage: asbench [--filter substring] [--time milliseconds] [--json file]
+*/
+
+#define ARGSTREAM_THREADS
+#include "../argstream.h"
+
+#include <atomic>
+#include <chrono>
+#include <codecvt>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <locale>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Allocation counting
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+namespace
+{
+	std::atomic<size_t> g_allocations(0);
+	std::atomic<size_t> g_allocatedBytes(0);
+
+	inline void* countedAllocate(size_t size)
+	{
+		g_allocations.fetch_add(1, std::memory_order_relaxed);
+		g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+		void* p = std::malloc(size == 0 ? 1 : size);
+		if (p == NULL)
+		{
+			throw std::bad_alloc();
+		}
+		return p;
+	}
+}
+
+void* operator new(size_t size) { return countedAllocate(size); }
+void* operator new[](size_t size) { return countedAllocate(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Harness
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+namespace
+{
+	struct result
+	{
+		std::string name;
+		const char* type;
+		size_t ops;
+		double nsPerOp;
+		double allocationsPerOp;
+		double bytesPerOp;
+	};
+
+	std::vector<result> g_results;
+	std::string g_filter;
+	int g_minTime = 200;
+
+	template<typename CHARTYPE> const char* typeName();
+	template<> const char* typeName<char>() { return "char"; }
+	template<> const char* typeName<wchar_t>() { return "wchar_t"; }
+
+	/**
+		Run f until g_minTime milliseconds went by, f doing opsPerCall
+		operations at each call.
+	*/
+	template<typename CHARTYPE, typename F>
+	void measure(const std::string& name, size_t opsPerCall, F f)
+	{
+		std::string fullName = name + "/" + typeName<CHARTYPE>();
+		if (fullName.find(g_filter) == std::string::npos)
+		{
+			return;
+		}
+		f(); // Warm up the caches and the buffers kept between calls
+
+		typedef std::chrono::steady_clock clock;
+		size_t calls = 0;
+		size_t allocations = g_allocations.load();
+		size_t bytes = g_allocatedBytes.load();
+		clock::time_point start = clock::now();
+		clock::duration elapsed;
+		do
+		{
+			f();
+			++calls;
+			elapsed = clock::now() - start;
+		} while (elapsed < std::chrono::milliseconds(g_minTime));
+
+		double ops = static_cast<double>(calls) * opsPerCall;
+		result r = {
+			name,
+			typeName<CHARTYPE>(),
+			calls * opsPerCall,
+			std::chrono::duration<double, std::nano>(elapsed).count() / ops,
+			(g_allocations.load() - allocations) / ops,
+			(g_allocatedBytes.load() - bytes) / ops
+		};
+		g_results.push_back(r);
+		printf("%-28s %-8s %14.1f ns/op %10.2f allocs/op %12.1f bytes/op\n",
+			r.name.c_str(), r.type, r.nsPerOp, r.allocationsPerOp, r.bytesPerOp);
+		fflush(stdout);
+	}
+
+	void writeJson(std::ostream& os)
+	{
+		os << "{\n  \"benchmarks\": [\n";
+		for (size_t i = 0; i < g_results.size(); ++i)
+		{
+			const result& r = g_results[i];
+			char line[512];
+			snprintf(line, sizeof(line),
+				"    {\"name\": \"%s\", \"type\": \"%s\", \"ops\": %zu, \"ns_per_op\": %.3f, "
+				"\"allocs_per_op\": %.3f, \"bytes_per_op\": %.3f}%s\n",
+				r.name.c_str(), r.type, r.ops, r.nsPerOp, r.allocationsPerOp, r.bytesPerOp,
+				i + 1 < g_results.size() ? "," : "");
+			os << line;
+		}
+		os << "  ]\n}\n";
+	}
+
+	template<typename CHARTYPE>
+	std::basic_string<CHARTYPE> widen(const std::string& s)
+	{
+		return std::basic_string<CHARTYPE>(s.begin(), s.end());
+	}
+
+	/**
+		Command line arguments: pairs of a long option and a value, with a
+		few short options among them.
+	*/
+	template<typename CHARTYPE>
+	std::vector<std::basic_string<CHARTYPE> > makeArguments(size_t count)
+	{
+		std::vector<std::basic_string<CHARTYPE> > args;
+		args.push_back(widen<CHARTYPE>("bench"));
+		char token[64];
+		for (size_t i = 0; args.size() < count; ++i)
+		{
+			switch (i % 4)
+			{
+			case 0: snprintf(token, sizeof(token), "--name%zu", i % 64); break;
+			case 1: snprintf(token, sizeof(token), "%zu", i * 7919); break;
+			case 2: snprintf(token, sizeof(token), "-%c", static_cast<char>('a' + i % 26)); break;
+			default: snprintf(token, sizeof(token), "/data/set_%zu/part-%05zu.csv", i / 64, i); break;
+			}
+			args.push_back(widen<CHARTYPE>(token));
+		}
+		return args;
+	}
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Cases
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+namespace
+{
+	template<typename CHARTYPE>
+	void benchParse()
+	{
+		const size_t sizes[] = { 10, 1000, 100000 };
+		std::basic_string<CHARTYPE> name0 = widen<CHARTYPE>("name0");
+		std::basic_string<CHARTYPE> name1 = widen<CHARTYPE>("name1");
+		std::basic_string<CHARTYPE> desc = widen<CHARTYPE>("desc");
+		for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+		{
+			std::vector<std::basic_string<CHARTYPE> > args = makeArguments<CHARTYPE>(sizes[i]);
+			std::vector<const CHARTYPE*> argv;
+			std::basic_string<CHARTYPE> line;
+			for (size_t j = 0; j < args.size(); ++j)
+			{
+				argv.push_back(args[j].c_str());
+				line += args[j];
+				line += ' ';
+			}
+
+			auto bind = [&](argstream::argstream<CHARTYPE>& as) {
+				int value = 0;
+				std::basic_string<CHARTYPE> text;
+				bool flag = false;
+				as >> argstream::parameter(CHARTYPE('x'), name0.c_str(), value, desc.c_str(), false)
+					>> argstream::parameter(CHARTYPE('y'), name1.c_str(), text, desc.c_str(), false)
+					>> argstream::option(CHARTYPE('a'), desc.c_str(), flag, desc.c_str());
+			};
+
+			char name[64];
+			snprintf(name, sizeof(name), "parse/argv/%zu", sizes[i]);
+			measure<CHARTYPE>(name, 1, [&]() {
+				argstream::argstream<CHARTYPE> as(static_cast<int>(argv.size()), &argv[0]);
+				bind(as);
+			});
+
+			snprintf(name, sizeof(name), "parse/string/%zu", sizes[i]);
+			measure<CHARTYPE>(name, 1, [&]() {
+				argstream::argstream<CHARTYPE> as(line.c_str(), argstream::SPLIT_POSIX);
+				bind(as);
+			});
+
+			snprintf(name, sizeof(name), "parse/bind/%zu", sizes[i]);
+			measure<CHARTYPE>(name, 1, [&]() {
+				argstream::argstream<CHARTYPE> as(static_cast<int>(argv.size()), &argv[0]);
+				int value = 0;
+				std::basic_string<CHARTYPE> text;
+				bool flag = false;
+				as.bind(argstream::parameter(CHARTYPE('x'), name0.c_str(), value, desc.c_str(), false),
+					argstream::parameter(CHARTYPE('y'), name1.c_str(), text, desc.c_str(), false),
+					argstream::option(CHARTYPE('a'), desc.c_str(), flag, desc.c_str()));
+			});
+		}
+	}
+
+	template<typename CHARTYPE, typename T>
+	void benchValue(const char* name, const char* format, double scale)
+	{
+		const size_t count = 1000;
+		std::vector<std::basic_string<CHARTYPE> > texts;
+		char text[64];
+		for (size_t i = 0; i < count; ++i)
+		{
+			snprintf(text, sizeof(text), format, static_cast<double>(i * 104729 % 1000003) * scale);
+			texts.push_back(widen<CHARTYPE>(text));
+		}
+		volatile size_t sink = 0;
+		measure<CHARTYPE>(name, count, [&]() {
+			argstream::ValueParser<CHARTYPE, T> parser;
+			T t = T();
+			for (size_t i = 0; i < texts.size(); ++i)
+			{
+				sink = sink + parser(texts[i], t);
+			}
+		});
+	}
+
+	template<typename CHARTYPE>
+	void benchValues()
+	{
+		benchValue<CHARTYPE, int>("value/int", "%.0f", 1.0);
+		benchValue<CHARTYPE, float>("value/float", "%.4f", 0.001);
+		benchValue<CHARTYPE, double>("value/double", "%.9g", 3.14159e-3);
+		benchValue<CHARTYPE, std::basic_string<CHARTYPE> >("value/string", "/data/file_%.0f.csv", 1.0);
+	}
+
+	template<typename CHARTYPE>
+	void benchPositional()
+	{
+		// xargs-style: an option followed by many positional paths or numbers
+		const size_t count = 10000;
+		std::vector<std::basic_string<CHARTYPE> > paths;
+		std::vector<std::basic_string<CHARTYPE> > numbers;
+		paths.push_back(widen<CHARTYPE>("bench"));
+		numbers.push_back(widen<CHARTYPE>("bench"));
+		paths.push_back(widen<CHARTYPE>("-v"));
+		numbers.push_back(widen<CHARTYPE>("-v"));
+		char text[64];
+		for (size_t i = 0; i < count; ++i)
+		{
+			snprintf(text, sizeof(text), "/data/set_%zu/part-%05zu.csv", i / 64, i);
+			paths.push_back(widen<CHARTYPE>(text));
+			snprintf(text, sizeof(text), "%zu", i * 7919);
+			numbers.push_back(widen<CHARTYPE>(text));
+		}
+		std::vector<const CHARTYPE*> pathArgv, numberArgv;
+		for (size_t i = 0; i < paths.size(); ++i)
+		{
+			pathArgv.push_back(paths[i].c_str());
+			numberArgv.push_back(numbers[i].c_str());
+		}
+		std::basic_string<CHARTYPE> desc = widen<CHARTYPE>("desc");
+		bool verbose = false;
+
+		measure<CHARTYPE>("values/vector/string", count, [&]() {
+			argstream::argstream<CHARTYPE> as(static_cast<int>(pathArgv.size()), &pathArgv[0]);
+			std::vector<std::basic_string<CHARTYPE> > files;
+			as >> argstream::option(CHARTYPE('v'), desc.c_str(), verbose, desc.c_str())
+				>> argstream::values<std::basic_string<CHARTYPE> >(files, desc.c_str());
+		});
+		measure<CHARTYPE>("values/vector/int", count, [&]() {
+			argstream::argstream<CHARTYPE> as(static_cast<int>(numberArgv.size()), &numberArgv[0]);
+			std::vector<int> ints;
+			as >> argstream::option(CHARTYPE('v'), desc.c_str(), verbose, desc.c_str())
+				>> argstream::values<int>(ints, desc.c_str());
+		});
+		measure<CHARTYPE>("values/iterator/int", count, [&]() {
+			argstream::argstream<CHARTYPE> as(static_cast<int>(numberArgv.size()), &numberArgv[0]);
+			std::vector<int> ints;
+			as >> argstream::option(CHARTYPE('v'), desc.c_str(), verbose, desc.c_str())
+				>> argstream::values<int>(std::back_inserter(ints), desc.c_str());
+		});
+	}
+
+	template<typename CHARTYPE>
+	void benchUsage()
+	{
+		const size_t holders = 100;
+		std::vector<std::basic_string<CHARTYPE> > names;
+		std::vector<std::basic_string<CHARTYPE> > descriptions;
+		for (size_t i = 0; i < holders; ++i)
+		{
+			char text[64];
+			snprintf(text, sizeof(text), "parameter%zu", i);
+			names.push_back(widen<CHARTYPE>(text));
+			snprintf(text, sizeof(text), "Description of parameter %zu", i);
+			descriptions.push_back(widen<CHARTYPE>(text));
+		}
+		std::vector<int> values(holders);
+		std::basic_string<CHARTYPE> program = widen<CHARTYPE>("bench");
+		const CHARTYPE* argv[] = { program.c_str() };
+		argstream::argstream<CHARTYPE> as(1, argv);
+		for (size_t i = 0; i < holders; ++i)
+		{
+			as >> argstream::parameter(CHARTYPE('a' + i % 26), names[i].c_str(), values[i], descriptions[i].c_str(), false);
+		}
+		volatile size_t sink = 0;
+		measure<CHARTYPE>("usage/100", 1, [&]() {
+			sink = sink + as.usage().size();
+		});
+
+		// Without a call to usage(), nothing is cached and the text is
+		// formatted into the sink each time.
+		argstream::argstream<CHARTYPE> streamed(1, argv);
+		for (size_t i = 0; i < holders; ++i)
+		{
+			streamed >> argstream::parameter(CHARTYPE('a' + i % 26), names[i].c_str(), values[i], descriptions[i].c_str(), false);
+		}
+		std::basic_ostringstream<CHARTYPE> os;
+		measure<CHARTYPE>("usage/100/stream", 1, [&]() {
+			os.str(std::basic_string<CHARTYPE>());
+			streamed.usage(os);
+		});
+#ifndef _WIN32
+		int fd = open("/dev/null", O_WRONLY);
+		measure<CHARTYPE>("usage/100/fd", 1, [&]() {
+			streamed.usage(fd);
+		});
+		close(fd);
+#endif
+	}
+
+	template<typename CHARTYPE>
+	void benchDeclare()
+	{
+		// Cost of declaring many holders when the usage is never printed
+		const size_t holders = 200;
+		std::vector<std::basic_string<CHARTYPE> > names;
+		for (size_t i = 0; i < holders; ++i)
+		{
+			char text[64];
+			snprintf(text, sizeof(text), "option%zu", i);
+			names.push_back(widen<CHARTYPE>(text));
+		}
+		std::basic_string<CHARTYPE> desc = widen<CHARTYPE>("Description of the option");
+		std::basic_string<CHARTYPE> program = widen<CHARTYPE>("bench");
+		std::basic_string<CHARTYPE> given = widen<CHARTYPE>("--option7");
+		const CHARTYPE* argv[] = { program.c_str(), given.c_str() };
+		std::vector<char> flags(holders);
+		measure<CHARTYPE>("declare/200", 1, [&]() {
+			argstream::argstream<CHARTYPE> as(2, argv);
+			for (size_t i = 0; i < holders; ++i)
+			{
+				bool flag = false;
+				as >> argstream::option(CHARTYPE('a' + i % 26), names[i].c_str(), flag, desc.c_str());
+				flags[i] = flag;
+			}
+		});
+	}
+
+	template<typename CHARTYPE>
+	void benchRejected()
+	{
+		// A validator counting the error codes of rejected command lines,
+		// the messages are never formatted.
+		std::basic_string<CHARTYPE> line = widen<CHARTYPE>(
+			"job --threads many --input /data/part-00042.csv --retries -x extra");
+		std::basic_string<CHARTYPE> threadsName = widen<CHARTYPE>("threads");
+		std::basic_string<CHARTYPE> inputName = widen<CHARTYPE>("input");
+		std::basic_string<CHARTYPE> retriesName = widen<CHARTYPE>("retries");
+		std::basic_string<CHARTYPE> outputName = widen<CHARTYPE>("output");
+		std::basic_string<CHARTYPE> desc = widen<CHARTYPE>("desc");
+		size_t counts[argstream::ERR_UNUSED + 1] = { 0 };
+		measure<CHARTYPE>("errors/codes", 1, [&]() {
+			argstream::argstream<CHARTYPE> as(line.c_str(), argstream::SPLIT_POSIX);
+			int threads = 0, retries = 0;
+			std::basic_string<CHARTYPE> input, output;
+			as >> argstream::parameter(CHARTYPE('t'), threadsName.c_str(), threads, desc.c_str(), false)
+				>> argstream::parameter(CHARTYPE('i'), inputName.c_str(), input, desc.c_str(), false)
+				>> argstream::parameter(CHARTYPE('r'), retriesName.c_str(), retries, desc.c_str(), false)
+				>> argstream::parameter(CHARTYPE('o'), outputName.c_str(), output, desc.c_str(), true);
+			as.reportUnused();
+			for (const typename argstream::argstream<CHARTYPE>::error_record& e:as.errors())
+			{
+				++counts[e.code];
+			}
+		});
+	}
+
+	template<typename CHARTYPE>
+	void benchToString()
+	{
+		const char* utf8 = "R\xc3\xa9pertoire des donn\xc3\xa9""es \xe4\xb8\xad\xe6\x96\x87 /data/input.csv";
+		const wchar_t* wide = L"Répertoire des données 中文 /data/input.csv";
+		volatile size_t sink = 0;
+		measure<CHARTYPE>("tostring/utf8", 1, [&]() {
+			sink = sink + argstream::TSTR<CHARTYPE>::ToString(utf8).size();
+		});
+		measure<CHARTYPE>("tostring/wide", 1, [&]() {
+			sink = sink + argstream::TSTR<CHARTYPE>::ToString(wide).size();
+		});
+	}
+
+	/**
+		UTF-8 text of about size bytes, ASCII only or mixed with accented
+		and CJK characters.
+	*/
+	std::string makeUtf8(size_t size, bool ascii)
+	{
+		const char* piece = ascii ?
+			"/data/input_set/records/part-00042.csv " :
+			"/donn\xc3\xa9""es/r\xc3\xa9pertoire \xe4\xb8\xad\xe6\x96\x87/part.csv ";
+		std::string s;
+		while (s.size() < size)
+		{
+			s += piece;
+		}
+		return s;
+	}
+
+	/**
+		The char cases decode UTF-8 into wchar_t, the wchar_t cases encode
+		wchar_t into UTF-8; the time is per input character.
+	*/
+	template<typename CHARTYPE>
+	void benchTranscode();
+
+	template<>
+	void benchTranscode<char>()
+	{
+		for (int ascii = 1; ascii >= 0; --ascii)
+		{
+			std::string text = makeUtf8(4096, ascii != 0);
+			std::string name = ascii ? "utf8/ascii/" : "utf8/mixed/";
+			std::vector<wchar_t> out(argstream::Utf8::maxDecodedSize(text.size()));
+			volatile size_t sink = 0;
+			for (int level = argstream::SIMD_SCALAR; level <= std::min<int>(argstream::simd_supported(), argstream::SIMD_SSE2); ++level)
+			{
+				argstream::set_simd_level(static_cast<argstream::SIMD_LEVEL>(level));
+				measure<char>(name + (level == argstream::SIMD_SCALAR ? "scalar" : "sse2"), text.size(), [&]() {
+					sink = sink + argstream::Utf8::decode(text.data(), text.size(), &out[0]).written;
+				});
+			}
+			argstream::set_simd_level(argstream::simd_supported());
+			measure<char>(name + "codecvt", text.size(), [&]() {
+				std::wstring_convert<std::codecvt_utf8<wchar_t> > conv;
+				sink = sink + conv.from_bytes(text).size();
+			});
+		}
+	}
+
+	template<>
+	void benchTranscode<wchar_t>()
+	{
+		for (int ascii = 1; ascii >= 0; --ascii)
+		{
+			std::string utf8 = makeUtf8(4096, ascii != 0);
+			std::wstring text;
+			argstream::Utf8::decode(utf8.data(), utf8.size(), text);
+			std::string name = ascii ? "utf8/ascii/" : "utf8/mixed/";
+			std::vector<char> out(argstream::Utf8::maxEncodedSize(text.size()));
+			volatile size_t sink = 0;
+			for (int level = argstream::SIMD_SCALAR; level <= std::min<int>(argstream::simd_supported(), argstream::SIMD_SSE2); ++level)
+			{
+				argstream::set_simd_level(static_cast<argstream::SIMD_LEVEL>(level));
+				measure<wchar_t>(name + (level == argstream::SIMD_SCALAR ? "scalar" : "sse2"), text.size(), [&]() {
+					sink = sink + argstream::Utf8::encode(text.data(), text.size(), &out[0]).written;
+				});
+			}
+			argstream::set_simd_level(argstream::simd_supported());
+			measure<wchar_t>(name + "codecvt", text.size(), [&]() {
+				std::wstring_convert<std::codecvt_utf8<wchar_t> > conv;
+				sink = sink + conv.to_bytes(text).size();
+			});
+		}
+	}
+
+	template<typename CHARTYPE>
+	void benchBatch()
+	{
+		const size_t count = 10000;
+		std::vector<std::basic_string<CHARTYPE> > lines;
+		for (size_t i = 0; i < count; ++i)
+		{
+			char text[128];
+			snprintf(text, sizeof(text), "job --threads %zu --input /data/part-%05zu.csv %s", i % 16, i, i % 3 ? "-v" : "");
+			lines.push_back(widen<CHARTYPE>(text));
+		}
+		int threads = 0;
+		std::basic_string<CHARTYPE> input;
+		bool verbose = false;
+		std::basic_string<CHARTYPE> threadsName = widen<CHARTYPE>("threads");
+		std::basic_string<CHARTYPE> inputName = widen<CHARTYPE>("input");
+		std::basic_string<CHARTYPE> verboseName = widen<CHARTYPE>("verbose");
+		std::basic_string<CHARTYPE> desc = widen<CHARTYPE>("desc");
+		argstream::schema<CHARTYPE> sc;
+		sc >> argstream::parameter(CHARTYPE('t'), threadsName.c_str(), threads, desc.c_str(), false)
+			>> argstream::parameter(CHARTYPE('i'), inputName.c_str(), input, desc.c_str(), false)
+			>> argstream::option(CHARTYPE('v'), verboseName.c_str(), verbose, desc.c_str());
+		argstream::batch<CHARTYPE> b(sc, false, argstream::SPLIT_POSIX);
+		b.reserve(count);
+
+		size_t cores = std::thread::hardware_concurrency();
+		for (size_t workers = 1; workers <= std::max<size_t>(cores, 1); workers *= 2)
+		{
+			char name[64];
+			snprintf(name, sizeof(name), "batch/threads/%zu", workers);
+			measure<CHARTYPE>(name, count, [&]() {
+				b.clear();
+				b.parse(lines.begin(), lines.end(), workers);
+			});
+		}
+	}
+
+#ifndef _WIN32
+	/**
+		Path of a response file of about 50MB of arguments, one per line,
+		written once and removed at exit.
+	*/
+	const std::string& responseFile()
+	{
+		static std::string path;
+		if (path.empty())
+		{
+			char name[] = "/tmp/asbench_XXXXXX";
+			int fd = mkstemp(name);
+			if (fd < 0)
+			{
+				return path;
+			}
+			std::string text;
+			char token[64];
+			for (size_t i = 0; text.size() < 50 * 1024 * 1024; ++i)
+			{
+				switch (i % 4)
+				{
+				case 0: snprintf(token, sizeof(token), "--name%zu\n", i % 64); break;
+				case 1: snprintf(token, sizeof(token), "%zu\n", i * 7919); break;
+				case 2: snprintf(token, sizeof(token), "-%c\n", static_cast<char>('a' + i % 26)); break;
+				default: snprintf(token, sizeof(token), "'/data/set %zu/part-%05zu.csv'\n", i / 64, i); break;
+				}
+				text += token;
+			}
+			bool written = write(fd, text.data(), text.size()) == static_cast<ssize_t>(text.size());
+			close(fd);
+			if (written)
+			{
+				path = name;
+				atexit([]() { unlink(responseFile().c_str()); });
+			}
+			else
+			{
+				unlink(name);
+			}
+		}
+		return path;
+	}
+
+	template<typename CHARTYPE>
+	void benchResponseFile()
+	{
+		// A build tool given its inputs in @file: expanded from the mapping,
+		// against reading the file and splitting it as a command line string.
+		if (responseFile().empty())
+		{
+			return;
+		}
+		std::basic_string<CHARTYPE> program = widen<CHARTYPE>("bench");
+		std::basic_string<CHARTYPE> file = widen<CHARTYPE>("@" + responseFile());
+		const CHARTYPE* argv[] = { program.c_str(), file.c_str() };
+		std::basic_string<CHARTYPE> name0 = widen<CHARTYPE>("name0");
+		std::basic_string<CHARTYPE> desc = widen<CHARTYPE>("desc");
+		auto bind = [&](argstream::argstream<CHARTYPE>& as) {
+			int value = 0;
+			bool flag = false;
+			as >> argstream::parameter(CHARTYPE('x'), name0.c_str(), value, desc.c_str(), false)
+				>> argstream::option(CHARTYPE('a'), desc.c_str(), flag, desc.c_str());
+		};
+		measure<CHARTYPE>("rsp/50MB/mapped", 1, [&]() {
+			argstream::argstream<CHARTYPE> as(2, argv, argstream::RESPONSE_FILE_EXPAND, argstream::new_delete_resource(), argstream::SPLIT_POSIX);
+			bind(as);
+		});
+		measure<CHARTYPE>("rsp/50MB/read", 1, [&]() {
+			std::ifstream is(responseFile().c_str(), std::ios::binary);
+			std::string text = "bench " + std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+			argstream::argstream<CHARTYPE> as(argstream::TSTR<CHARTYPE>::ToString(text.c_str()).c_str(), argstream::SPLIT_POSIX);
+			bind(as);
+		});
+	}
+
+	const std::string& configFile()
+	{
+		static std::string path;
+		if (path.empty())
+		{
+			char name[] = "/tmp/asbench_conf_XXXXXX";
+			int fd = mkstemp(name);
+			if (fd < 0)
+			{
+				return path;
+			}
+			std::string text = "# Settings of the benchmark\n";
+			char line[64];
+			for (size_t i = 0; i < 10000; ++i)
+			{
+				snprintf(line, sizeof(line), "key%05zu = %zu\n", i, i * 7919);
+				text += line;
+			}
+			bool written = write(fd, text.data(), text.size()) == static_cast<ssize_t>(text.size());
+			close(fd);
+			if (written)
+			{
+				path = name;
+				atexit([]() { unlink(configFile().c_str()); });
+			}
+			else
+			{
+				unlink(name);
+			}
+		}
+		return path;
+	}
+
+	template<typename CHARTYPE>
+	void benchConfig()
+	{
+		// Loading a configuration file of 10k keys under a short command
+		// line, then binding 200 holders against the merged tokens.
+		if (configFile().empty())
+		{
+			return;
+		}
+		std::basic_string<CHARTYPE> program = widen<CHARTYPE>("bench");
+		std::basic_string<CHARTYPE> key = widen<CHARTYPE>("--key00042");
+		std::basic_string<CHARTYPE> value = widen<CHARTYPE>("1");
+		const CHARTYPE* argv[] = { program.c_str(), key.c_str(), value.c_str() };
+		std::basic_string<CHARTYPE> path = widen<CHARTYPE>(configFile());
+		std::vector<std::basic_string<CHARTYPE> > names;
+		for (size_t i = 0; i < 200; ++i)
+		{
+			char name[16];
+			snprintf(name, sizeof(name), "key%05zu", i * 50);
+			names.push_back(widen<CHARTYPE>(name));
+		}
+		std::basic_string<CHARTYPE> desc = widen<CHARTYPE>("desc");
+		measure<CHARTYPE>("config/10k keys/load", 10000, [&]() {
+			argstream::argstream<CHARTYPE> as(3, argv);
+			as.config(path.c_str());
+		});
+		measure<CHARTYPE>("config/10k keys/bind 200", 200, [&]() {
+			argstream::argstream<CHARTYPE> as(3, argv);
+			as.config(path.c_str());
+			int values[200];
+			for (size_t i = 0; i < names.size(); ++i)
+			{
+				as >> argstream::parameter(CHARTYPE(), names[i].c_str(), values[i], desc.c_str(), false);
+			}
+		});
+	}
+
+	template<typename CHARTYPE>
+	void benchEnvironment()
+	{
+		// Parameters falling back on environment variables. environ is
+		// hashed once per parser and the cost is shared by its holders,
+		// each lookup is then constant whatever the number of variables.
+		static bool exported = false;
+		if (!exported)
+		{
+			for (size_t i = 0; i < 2000; ++i)
+			{
+				char name[32];
+				char value[32];
+				snprintf(name, sizeof(name), "ASBENCH_OPTION%zu", i);
+				snprintf(value, sizeof(value), "%zu", i * 7919);
+				setenv(name, value, 1);
+			}
+			exported = true;
+		}
+		std::basic_string<CHARTYPE> program = widen<CHARTYPE>("bench");
+		const CHARTYPE* argv[] = { program.c_str() };
+		std::basic_string<CHARTYPE> desc = widen<CHARTYPE>("desc");
+		std::vector<std::basic_string<CHARTYPE> > names;
+		std::vector<std::basic_string<CHARTYPE> > variables;
+		for (size_t i = 0; i < 2000; ++i)
+		{
+			char text[32];
+			snprintf(text, sizeof(text), "option%zu", i);
+			names.push_back(widen<CHARTYPE>(text));
+			snprintf(text, sizeof(text), "ASBENCH_OPTION%zu", i);
+			variables.push_back(widen<CHARTYPE>(text));
+		}
+		std::vector<int> values(2000);
+		for (size_t holders : { size_t(200), size_t(2000) })
+		{
+			measure<CHARTYPE>(holders == 200 ? "env/200" : "env/2000", holders, [&]() {
+				argstream::argstream<CHARTYPE> as(1, argv);
+				for (size_t i = 0; i < holders; ++i)
+				{
+					as >> argstream::parameter(CHARTYPE(), names[i].c_str(), values[i], desc.c_str(), false, variables[i].c_str());
+				}
+			});
+		}
+	}
+#endif
+
+	template<typename CHARTYPE>
+	void benchAll()
+	{
+		benchParse<CHARTYPE>();
+		benchValues<CHARTYPE>();
+		benchPositional<CHARTYPE>();
+		benchUsage<CHARTYPE>();
+		benchDeclare<CHARTYPE>();
+		benchRejected<CHARTYPE>();
+		benchToString<CHARTYPE>();
+		benchTranscode<CHARTYPE>();
+		benchBatch<CHARTYPE>();
+#ifndef _WIN32
+		benchResponseFile<CHARTYPE>();
+		benchConfig<CHARTYPE>();
+		benchEnvironment<CHARTYPE>();
+#endif
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::string jsonPath;
+	argstream::argstream<char> as(argc, argv);
+	as >> argstream::parameter('f', "filter", g_filter, "Only run the cases whose name/type contains this text", false)
+		>> argstream::parameter('t', "time", g_minTime, "Minimum time of each case in milliseconds", false)
+		>> argstream::parameter('j', "json", jsonPath, "Write the results as JSON to this file, - for stdout", false)
+		>> argstream::help<char>();
+	if (as.defaultErrorHandling() != argstream::RESULT_OF_PARSE::PARSED_OK)
+	{
+		return 1;
+	}
+
+	benchAll<char>();
+	benchAll<wchar_t>();
+
+	if (jsonPath == "-")
+	{
+		writeJson(std::cout);
+	}
+	else if (!jsonPath.empty())
+	{
+		std::ofstream os(jsonPath.c_str());
+		writeJson(os);
+	}
+	return 0;
+}
@@ -0,0 +1,107 @@
+/**
+	simd_scan.cpp
+	Purpose: Measure how fast the tokenizer goes through long command lines
+	with each instruction set: the scan for stop characters alone, and the
+	whole split.
+*/
+
+#include "../argstream.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const char* LEVEL_NAMES[] = { "scalar", "sse2", "avx2" };
+
+	/**
+		A command line of about size characters made of a file list, as
+		built by the jobs which pass their inputs on the command line.
+	*/
+	template<typename CHARTYPE>
+	std::basic_string<CHARTYPE> fileListCommandLine(size_t size)
+	{
+		std::string line("process --threads 8 --output /var/tmp/out.bin");
+		char path[128];
+		for (unsigned i = 0; line.size() < size; ++i)
+		{
+			if (i % 8 == 0)
+			{
+				snprintf(path, sizeof(path), " \"/data/input set %u/part-%05u.csv\"", i / 8, i);
+			}
+			else
+			{
+				snprintf(path, sizeof(path), " /data/input_set_%u/records/part-%05u.csv", i / 8, i);
+			}
+			line += path;
+		}
+		return std::basic_string<CHARTYPE>(line.begin(), line.end());
+	}
+
+	/**
+		Run f until at least 200ms went by.
+
+		@return Bytes per second.
+	*/
+	template<typename F>
+	double throughput(size_t bytes, F f)
+	{
+		typedef std::chrono::steady_clock clock;
+		size_t runs = 0;
+		clock::time_point start = clock::now();
+		clock::duration elapsed;
+		do
+		{
+			f();
+			++runs;
+			elapsed = clock::now() - start;
+		} while (elapsed < std::chrono::milliseconds(200));
+		return bytes * static_cast<double>(runs) / std::chrono::duration<double>(elapsed).count();
+	}
+
+	template<typename CHARTYPE>
+	void run(const char* type, size_t size)
+	{
+		std::basic_string<CHARTYPE> line = fileListCommandLine<CHARTYPE>(size);
+		const CHARTYPE* first = line.c_str();
+		const CHARTYPE* last = first + line.size();
+		size_t bytes = line.size() * sizeof(CHARTYPE);
+		std::vector<CHARTYPE> buffer;
+		std::vector<const CHARTYPE*> argv;
+		volatile size_t sink = 0;
+
+		for (int level = argstream::SIMD_SCALAR; level <= argstream::simd_supported(); ++level)
+		{
+			argstream::set_simd_level(static_cast<argstream::SIMD_LEVEL>(level));
+			double scan = throughput(bytes, [&]() {
+				size_t stops = 0;
+				for (const CHARTYPE* p = first; p < last; ++p)
+				{
+					p = argstream::Scanner<CHARTYPE>::find(p, last);
+					++stops;
+				}
+				sink = sink + stops;
+			});
+			double split = throughput(bytes, [&]() {
+				argstream::Tokenizer<CHARTYPE>::split(first, buffer, argv, argstream::SPLIT_POSIX);
+				sink = sink + argv.size();
+			});
+			printf("%-8s %-7s %8zu bytes  scan %8.1f MB/s  split %8.1f MB/s\n",
+				type, LEVEL_NAMES[level], bytes, scan / 1e6, split / 1e6);
+		}
+		argstream::set_simd_level(argstream::simd_supported());
+	}
+}
+
+int main()
+{
+	const size_t sizes[] = { 256, 128 * 1024 };
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+	{
+		run<char>("char", sizes[i]);
+		run<wchar_t>("wchar_t", sizes[i]);
+	}
+	return 0;
+}
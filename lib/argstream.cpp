@@ -0,0 +1,23 @@
+/**
+	argstream.cpp
+	Purpose: Compiled library mode of argstream. Built with
+	ARGSTREAM_EXTERN_TEMPLATE, it holds the only instantiation of
+	argstream<char> and argstream<wchar_t>; the translation units which
+	define the same macro and include argstream.h link with it instead of
+	compiling the parser again.
+
+	The macros which change the code of argstream (ARGSTREAM_INSTRUMENT,
+	ARGSTREAM_DEBUG, ARGSTREAM_NO_SIMD) must be the same here and in the
+	translation units using the library.
+*/
+
+#ifndef ARGSTREAM_EXTERN_TEMPLATE
+#define ARGSTREAM_EXTERN_TEMPLATE
+#endif
+#include "../argstream.h"
+
+namespace argstream
+{
+	template class argstream<char>;
+	template class argstream<wchar_t>;
+};
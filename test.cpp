@@ -3,6 +3,15 @@
 #endif
 #include <iostream>
 #include <string>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <list>
+#include <iterator>
+#include <cstring>
+#include <cstdio>
+#define ARGSTREAM_INSTRUMENT // Exercise the instrumentation hooks too
+#define ARGSTREAM_THREADS
 #include "argstream.h"
 
 using namespace std;
@@ -160,6 +169,157 @@ int main()
 		total_result &= TestEqual(TEST_STR1, testStr, L"Test: Parse command line.");
 	}
 
+	{ //Test string parameter 4
+		const wchar_t* TEST_STR1 = L"StringWithoutSpaces";
+		wstring cmdline = wstring(L"  test.exe\t-s  ") + wstring(TEST_STR1) + wstring(L"  ");
+		wstring testStr;
+		argstream::argstream<wchar_t> as(cmdline.c_str());
+		cmdline.assign(cmdline.size(), L'x'); // argstream keeps its own copy
+		as >> argstream::parameter(L's', L"testString", testStr, L"desc", false);
+		argstream::RESULT_OF_PARSE res = as.defaultErrorHandling(false);
+		argstream::RESULT_OF_PARSE res2 = argstream::RESULT_OF_PARSE::PARSED_OK;
+
+		total_result &= TestEqual(res, res2, L"Test: Parse argument");
+		total_result &= TestEqual(TEST_STR1, testStr, L"Test: Parse command line with extra spaces.");
+	}
+
+	{ //Test quoted command line
+		wstring testStr;
+		wstring testStr2;
+		argstream::argstream<wchar_t> as(L"test.exe -s \"/my path/a b.txt\" -t 'it'\\''s'\\ ok", argstream::SPLIT_POSIX);
+		as >> argstream::parameter(L's', L"testString", testStr, L"desc", false)
+			>> argstream::parameter(L't', L"testString2", testStr2, L"desc", false);
+		argstream::RESULT_OF_PARSE res = as.defaultErrorHandling(false);
+
+		total_result &= TestEqual(res, argstream::RESULT_OF_PARSE::PARSED_OK, L"Test: Parse quoted command line");
+		total_result &= TestEqual(wstring(L"/my path/a b.txt"), testStr, L"Test: Double quotes");
+		total_result &= TestEqual(wstring(L"it's ok"), testStr2, L"Test: Single quotes and escapes");
+	}
+
+	{ //Test Windows command line
+		const wchar_t* lines[] = {
+			L"\"C:\\Program Files\\test.exe\" \"abc\" d e",
+			L"test.exe a\\\\\\b d\"e f\"g h",
+			L"test.exe a\\\\\\\"b c d",
+			L"test.exe a\\\\\\\\\"b c\" d e",
+			L"test.exe \"a\"\"b\" c"
+		};
+		const wchar_t* expected[] = {
+			L"C:\\Program Files\\test.exe|abc|d|e",
+			L"test.exe|a\\\\\\b|de fg|h",
+			L"test.exe|a\\\"b|c|d",
+			L"test.exe|a\\\\b c|d|e",
+			L"test.exe|a\"b c"
+		};
+		bool same = true;
+		std::vector<wchar_t> buffer;
+		std::vector<const wchar_t*> argv;
+		for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); ++i)
+		{
+			argstream::Tokenizer<wchar_t>::split(lines[i], buffer, argv, argstream::SPLIT_WINDOWS);
+			wstring joined;
+			for (size_t j = 0; j < argv.size(); ++j)
+			{
+				if (j != 0) joined += L'|';
+				joined += argv[j];
+			}
+			same &= joined == expected[i];
+		}
+		total_result &= TestEqual(same, true, L"Test: Split like CommandLineToArgvW");
+	}
+
+	{ //Test SIMD scanning
+		wstring cmdline(L"test.exe");
+		for (int i = 0; i < 20; ++i)
+		{
+			cmdline += L" \"/data/r\u00e9pertoire \u4e2d/file\\\"name\" /data/plain_file_name_";
+			cmdline += wchar_t(L'a' + i);
+			cmdline += L"\t'single quoted path' escaped\\ space";
+		}
+		std::vector<wchar_t> buffer;
+		std::vector<const wchar_t*> argv;
+		argstream::set_simd_level(argstream::SIMD_SCALAR);
+		argstream::Tokenizer<wchar_t>::split(cmdline.c_str(), buffer, argv, argstream::SPLIT_POSIX);
+		std::vector<wstring> scalar(argv.begin(), argv.end());
+		bool same = scalar.size() == 81 && scalar[1] == L"/data/r\u00e9pertoire \u4e2d/file\"name";
+		for (int level = argstream::SIMD_SSE2; level <= argstream::simd_supported(); ++level)
+		{
+			argstream::set_simd_level(static_cast<argstream::SIMD_LEVEL>(level));
+			argstream::Tokenizer<wchar_t>::split(cmdline.c_str(), buffer, argv, argstream::SPLIT_POSIX);
+			same &= std::vector<wstring>(argv.begin(), argv.end()) == scalar;
+		}
+		argstream::set_simd_level(argstream::simd_supported());
+		total_result &= TestEqual(same, true, L"Test: SIMD and scalar split alike");
+	}
+
+	{ //Test UTF-8 transcoding
+		const char* utf8 = "/data/input_files/r\xc3\xa9pertoire/\xe4\xb8\xad\xf0\x9f\x98\x80.csv";
+		wstring wide;
+		argstream::transcode_result r = argstream::Utf8::decode(utf8, strlen(utf8), wide);
+		std::string back;
+		argstream::Utf8::encode(wide.data(), wide.size(), back);
+		total_result &= TestEqual(r.invalid == 0 && wide.find(L"r\u00e9pertoire/\u4e2d") != wstring::npos, true, L"Test: Decode UTF-8");
+		total_result &= TestEqual(back, std::string(utf8), L"Test: Encode UTF-8");
+
+		const char* invalid = "ab\xc3(\xed\xa0\x80" "cd";
+		r = argstream::Utf8::decode(invalid, strlen(invalid), wide);
+		total_result &= TestEqual(wide == L"ab\uFFFD(\uFFFD\uFFFD\uFFFDcd" && r.invalid == 4, true, L"Test: Replace invalid UTF-8");
+		r = argstream::Utf8::decode(invalid, strlen(invalid), wide, argstream::UTF_STRICT);
+		total_result &= TestEqual(r.read == 2 && wide == L"ab", true, L"Test: Stop at invalid UTF-8");
+	}
+
+	{ //Test memory resource
+		wstring testStr;
+		int testInt = 0;
+		char arena[4096];
+		argstream::monotonic_buffer_resource resource(arena, sizeof(arena));
+		{
+			argstream::argstream<wchar_t> as(L"test.exe -s text -i 12 -u", &resource);
+			as >> argstream::parameter(L's', L"testString", testStr, L"desc", false)
+				>> argstream::parameter(L'i', L"testInt", testInt, L"desc", false);
+			argstream::RESULT_OF_PARSE res = as.defaultErrorHandling(true);
+			total_result &= TestEqual(res, argstream::RESULT_OF_PARSE::PARSED_OK, L"Test: Parse with memory resource");
+		}
+		resource.release();
+		total_result &= TestEqual(wstring(L"text"), testStr, L"Test: String parsed with memory resource");
+		total_result &= TestEqual(12, testInt, L"Test: Int parsed with memory resource");
+		void* p = resource.allocate(16, 8);
+		total_result &= TestEqual(p >= static_cast<void*>(arena) && p < static_cast<void*>(arena + sizeof(arena)), true, L"Test: Buffer reused after release");
+	}
+
+	{ //Test instrumentation
+		struct recorder : public argstream::instrument<wchar_t>
+		{
+			std::vector<argstream::PHASE> phases;
+			std::vector<wstring> names;
+			size_t allocations;
+			recorder() : allocations(0) {}
+			virtual void record(const argstream::phase_record<wchar_t>& r)
+			{
+				phases.push_back(r.phase);
+				names.push_back(r.name.str());
+				allocations += r.allocations;
+			}
+		} rec;
+		argstream::counting_resource counter;
+		wstring testStr;
+		argstream::set_instrument<wchar_t>(&rec);
+		{
+			argstream::argstream<wchar_t> as(L"test.exe -s text", &counter);
+			as >> argstream::parameter(L's', L"testString", testStr, L"desc", false);
+			as.usage();
+			as.errorLog();
+		}
+		argstream::set_instrument<wchar_t>(NULL);
+		bool phases = rec.phases.size() == 4 &&
+			rec.phases[0] == argstream::PHASE_TOKENIZE &&
+			rec.phases[1] == argstream::PHASE_BIND && rec.names[1] == L"testString" &&
+			rec.phases[2] == argstream::PHASE_USAGE &&
+			rec.phases[3] == argstream::PHASE_ERROR_LOG;
+		total_result &= TestEqual(phases, true, L"Test: Instrumented phases");
+		total_result &= TestEqual(rec.allocations > 0 && rec.allocations <= counter.allocations(), true, L"Test: Counted allocations");
+	}
+
 	{ //Test int parameter
 		const int TEST_INT = 1234;
 		wchar_t const* const argv[] = {
@@ -178,6 +338,38 @@ int main()
 		total_result &= TestEqual(TEST_INT, testInt, L"Test: Parse int.");
 	}
 
+	{ //Test invalid int parameter
+		wchar_t const* const argv[] = {
+			L"test.exe",
+			L"-s",
+			L"12x",
+			L"-t",
+			L"2147483648",
+			L"-u",
+			L" 12",
+			L"-v",
+			L"12\t "
+		};
+		int argc = sizeof(argv)/sizeof(wchar_t*);
+		int testInt = 7;
+		int testInt2 = 8;
+		int testInt3 = 9;
+		int testInt4 = 10;
+		argstream::argstream<wchar_t> as(argc, argv);
+		as >> argstream::parameter(L's', L"testInt", testInt, L"desc", false)
+		   >> argstream::parameter(L't', L"testInt2", testInt2, L"desc", false)
+		   >> argstream::parameter(L'u', L"testInt3", testInt3, L"desc", false)
+		   >> argstream::parameter(L'v', L"testInt4", testInt4, L"desc", false);
+		argstream::RESULT_OF_PARSE res = as.defaultErrorHandling(false);
+		argstream::RESULT_OF_PARSE res2 = argstream::RESULT_OF_PARSE::PARSED_ERR_OTHER;
+
+		total_result &= TestEqual(res, res2, L"Test: Parse argument");
+		total_result &= TestEqual(7, testInt, L"Test: Trailing characters in int.");
+		total_result &= TestEqual(8, testInt2, L"Test: Int overflow.");
+		total_result &= TestEqual(12, testInt3, L"Test: Leading blanks in int.");
+		total_result &= TestEqual(12, testInt4, L"Test: Trailing blanks in int.");
+	}
+
 	{ //Test float parameter
 		const float TEST_FLOAT = 1234.01f;
 		wchar_t const* const argv[] = {
@@ -321,9 +513,29 @@ int main()
 		total_result &= TestEqual(res, res2, L"Test: Parse argument");
 		total_result &= TestEqual(TEST_OPT, testOpt, L"Test: Long parameter name");
 	}
-	/* It seems not good
+
+	{ //Test repeated parameter, the last one wins
+		wchar_t const* const argv[] = {
+			L"test.exe",
+			L"-s",
+			L"First",
+			L"--testString",
+			L"Second",
+			L"-s",
+			L"Third"
+		};
+		int argc = sizeof(argv)/sizeof(wchar_t*);
+		wstring testStr;
+		argstream::argstream<wchar_t> as(argc, argv);
+		as >> argstream::parameter(L's', L"testString", testStr, L"desc", false);
+		argstream::RESULT_OF_PARSE res = as.defaultErrorHandling(false);
+		argstream::RESULT_OF_PARSE res2 = argstream::RESULT_OF_PARSE::PARSED_ERR_UNUSED_PARAMETER;
+
+		total_result &= TestEqual(res, res2, L"Test: Parse argument");
+		total_result &= TestEqual(wstring(L"Third"), testStr, L"Test: Repeated parameter");
+	}
 	{ //Test values
-		wchar_t* argv[] = {
+		wchar_t const* const argv[] = {
 			L"test.exe",
 			L"--testString",
 			L"Value1",
@@ -333,15 +545,43 @@ int main()
 			L"AnotherValue"
 		};
 		int argc = sizeof(argv)/sizeof(wchar_t*);
-		bool testOpt = false;
+		wstring testStr;
+		vector<wstring> testValues;
 		argstream::argstream<wchar_t> as(argc, argv);
+		as >> argstream::parameter(L's', L"testString", testStr, L"desc", false)
+		   >> argstream::values<wstring>(testValues, L"desc");
 		argstream::RESULT_OF_PARSE res = as.defaultErrorHandling(false);
 		argstream::RESULT_OF_PARSE res2 = argstream::RESULT_OF_PARSE::PARSED_ERR_UNUSED_PARAMETER;
 
 		total_result &= TestEqual(res, res2, L"Test: Parse argument");
-		total_result &= TestEqual(TEST_OPT, testOpt, L"Test: Long parameter name");
+		total_result &= TestEqual(wstring(L"Value1"), testStr, L"Test: Parameter before values");
+		total_result &= TestEqual(testValues.size() == 3 && testValues[0] == L"Value2" &&
+			testValues[2] == L"AnotherValue", true, L"Test: Values");
+	}
+
+	{ //Test values with a length
+		wchar_t const* const argv[] = {
+			L"test.exe",
+			L"1",
+			L"2",
+			L"-o",
+			L"3",
+			L"x"
+		};
+		int argc = sizeof(argv)/sizeof(wchar_t*);
+		std::list<int> first;
+		vector<int> second;
+		bool testOpt = false;
+		argstream::argstream<wchar_t> as(argc, argv);
+		as >> argstream::option(L'o', L"testOpt", testOpt, L"desc")
+		   >> argstream::values<int>(std::back_inserter(first), L"desc", 2)
+		   >> argstream::values<int>(second, L"desc", 3);
+
+		total_result &= TestEqual(first.size() == 2 && first.back() == 2, true, L"Test: Values through an iterator");
+		total_result &= TestEqual(second.size() == 1 && second[0] == 3, true, L"Test: Invalid values dropped");
+		total_result &= TestEqual(as.isOk(), false, L"Test: Missing and invalid values");
+		total_result &= TestEqual(as.usage().find(L" b1 ... b3") != wstring::npos, true, L"Test: Values usage");
 	}
-	*/
 
 	{ //Test help request 1
 		const bool TEST_OPT = true;
@@ -375,6 +615,493 @@ int main()
 
 		total_result &= TestEqual(res, res2, L"Test: Help requested 2.");
 	}
+	{ //Test usage formatted once
+		wchar_t const* const argv[] = {
+			L"test.exe"
+		};
+		int argc = sizeof(argv)/sizeof(wchar_t*);
+		wstring testStr;
+		bool testOpt = false;
+		argstream::argstream<wchar_t> as(argc, argv);
+		as >> argstream::option(L'o', L"testOpt", testOpt, L"desc");
+		wstring usage = as.usage();
+		total_result &= TestEqual(usage, as.usage(), L"Test: Usage cached");
+		as >> argstream::parameter(L's', L"testString", testStr, L"desc", false);
+		total_result &= TestEqual(as.usage().find(L"Usage: test.exe [-o] [-s value]") != wstring::npos, true,
+			L"Test: Usage updated by a new holder");
+	}
+
+	{ //Test usage written to a stream and a file descriptor
+		char const* const argv[] = {
+			"test.exe",
+			"-x"
+		};
+		int argc = sizeof(argv)/sizeof(char*);
+		int testInt = 0;
+		bool testOpt = false;
+		argstream::argstream<char> as(argc, argv);
+		as >> argstream::parameter('s', "testInt", testInt, "desc", true)
+		   >> argstream::option('o', "testOpt", testOpt, "desc")
+		   >> argstream::example("test.exe -s 1", "desc");
+		ostringstream os;
+		as.usage(os);
+		as.errorLog(os);
+
+		total_result &= TestEqual(os.str() == as.usage() + as.errorLog(), true, L"Test: Usage and errors to a stream");
+#ifndef WIN32
+		FILE* f = tmpfile();
+		bool written = f != NULL && as.usage(fileno(f)) && as.errorLog(fileno(f));
+		string text;
+		char buffer[256];
+		size_t n;
+		for (rewind(f); (n = fread(buffer, 1, sizeof(buffer), f)) > 0;)
+		{
+			text.append(buffer, n);
+		}
+		fclose(f);
+		total_result &= TestEqual(written && text == os.str(), true, L"Test: Usage and errors to a file descriptor");
+#endif
+	}
+
+	{ //Test holders bound in one pass
+		wchar_t const* const argv[] = {
+			L"test.exe",
+			L"-s",
+			L"First",
+			L"--testInt",
+			L"12",
+			L"-o",
+			L"--testString",
+			L"Second",
+			L"-x"
+		};
+		int argc = sizeof(argv)/sizeof(wchar_t*);
+		wstring str1, str2;
+		int int1 = 0, int2 = 0;
+		bool opt1 = false, opt2 = false;
+		argstream::argstream<wchar_t> chained(argc, argv);
+		chained >> argstream::parameter(L's', L"testString", str1, L"desc", false)
+			>> argstream::parameter(L'i', L"testInt", int1, L"desc", true)
+			>> argstream::option(L'o', L"testOpt", opt1, L"desc")
+			>> argstream::help<wchar_t>();
+		argstream::argstream<wchar_t> bound(argc, argv);
+		bound.bind(argstream::parameter(L's', L"testString", str2, L"desc", false),
+			argstream::parameter(L'i', L"testInt", int2, L"desc", true),
+			argstream::option(L'o', L"testOpt", opt2, L"desc"),
+			argstream::help<wchar_t>());
+
+		total_result &= TestEqual(str1 == str2 && int1 == int2 && opt1 == opt2, true, L"Test: Bound values");
+		total_result &= TestEqual(wstring(L"First"), str2, L"Test: Bound short name wins");
+		total_result &= TestEqual(chained.usage(), bound.usage(), L"Test: Bound usage");
+		total_result &= TestEqual(chained.defaultErrorHandling(false), bound.defaultErrorHandling(false), L"Test: Bound result");
+	}
+
+	{ //Test error records
+		wchar_t const* const argv[] = {
+			L"test.exe",
+			L"-i",
+			L"abc",
+			L"-s",
+			L"-x",
+			L"1"
+		};
+		int argc = sizeof(argv)/sizeof(wchar_t*);
+		wstring str, mand;
+		int i = 0;
+		std::vector<int> ints;
+		argstream::argstream<wchar_t> as(argc, argv);
+		as >> argstream::parameter(L'i', L"testInt", i, L"desc", false)
+			>> argstream::parameter(L's', L"testString", str, L"desc", false)
+			>> argstream::parameter(L'm', L"testMandatory", mand, L"desc", true)
+			>> argstream::values<int>(ints, L"desc", 2);
+		const argstream::argstream<wchar_t>::error_vector& errors = as.errors();
+		total_result &= TestEqual(errors.size(), size_t(4), L"Test: Error count");
+		bool codes = errors.size() == 4 &&
+			errors[0].code == argstream::ERR_INVALID_VALUE && errors[0].position == 2 && errors[0].holder == 0 &&
+			errors[1].code == argstream::ERR_NO_VALUE && errors[1].position == 3 && errors[1].holder == 1 &&
+			errors[2].code == argstream::ERR_MISSING_MANDATORY && errors[2].holder == 2 &&
+			errors[3].code == argstream::ERR_MISSING_VALUES && errors[3].holder == 3;
+		total_result &= TestEqual(codes, true, L"Test: Error codes");
+		total_result &= TestEqual(as.errorLog(), wstring(
+			L"Invalid value abc following switch i\n"
+			L"No value following switch s on command line\n"
+			L"Mandatory parameter -m/--testMandatory missing\n"
+			L"Expecting 2 values\n"), L"Test: Error messages");
+		total_result &= TestEqual(as.reportUnused(), size_t(2), L"Test: Unused count");
+		total_result &= TestEqual(as.errorMessage(as.errors().back()), wstring(L"Unused argument -x"), L"Test: Unused message");
+
+		argstream::argstream<wchar_t> minus(L"test.exe -a-b", argstream::SPLIT_POSIX);
+		total_result &= TestEqual(minus.errors().size() == 1 && minus.errors()[0].code == argstream::ERR_MINUS_IN_SWITCH, true, L"Test: Minus in switch code");
+		total_result &= TestEqual(minus.errorLog(), wstring(L"- in the middle of a switch -a-b\n"), L"Test: Minus in switch message");
+	}
+
+	{ //Test unused positions
+		std::vector<wstring> args(1, L"test.exe");
+		for (int i = 0; i < 150; ++i)
+		{
+			args.push_back(L"--testInt");
+			args.push_back(L"1");
+		}
+		args.push_back(L"-ox");
+		args.push_back(L"left");
+		args.push_back(L"-o");
+		std::vector<const wchar_t*> argv;
+		for (const wstring& a:args) argv.push_back(a.c_str());
+		int i = 0;
+		bool o = false;
+		argstream::argstream<wchar_t> as(static_cast<int>(argv.size()), &argv[0]);
+		as >> argstream::parameter(L'i', L"testInt", i, L"desc", false)
+			>> argstream::option(L'o', L"testOpt", o, L"desc");
+		std::vector<size_t> expected;
+		for (size_t p = 2; p < 299; p += 2) expected.push_back(p); // Values of the overridden --testInt
+		expected.push_back(301);
+		expected.push_back(302);
+		total_result &= TestEqual(as.unusedPositions() == expected, true, L"Test: Unused positions");
+		total_result &= TestEqual(as.defaultErrorHandling(false), argstream::RESULT_OF_PARSE::PARSED_ERR_UNUSED_PARAMETER, L"Test: Unused result");
+
+		argstream::argstream<wchar_t> all(L"test.exe --testInt 2 -o", argstream::SPLIT_POSIX);
+		all >> argstream::parameter(L'i', L"testInt", i, L"desc", false)
+			>> argstream::option(L'o', L"testOpt", o, L"desc");
+		total_result &= TestEqual(all.unusedPositions().empty(), true, L"Test: No unused position");
+	}
+
+	{ //Test response files
+		{
+			std::ofstream a("argstream_test_a.rsp");
+			a << "--testInt 42 \"two words\"\n@argstream_test_b.rsp\n";
+			std::ofstream b("argstream_test_b.rsp");
+			b << "-o last @argstream_test_a.rsp";
+		}
+		wchar_t const* const argv[] = { L"test.exe", L"@argstream_test_a.rsp", L"first" };
+		int i = 0;
+		bool o = false;
+		std::vector<wstring> values;
+		argstream::argstream<wchar_t> as(3, argv, argstream::RESPONSE_FILE_EXPAND);
+		as >> argstream::parameter(L'i', L"testInt", i, L"desc", false)
+			>> argstream::values<wstring>(values, L"desc");
+		std::vector<wstring> expected;
+		expected.push_back(L"two words");
+		expected.push_back(L"@argstream_test_b.rsp");
+		expected.push_back(L"first");
+		total_result &= TestEqual(i, 42, L"Test: Response file value");
+		total_result &= TestEqual(values == expected, true, L"Test: Response file not recursive");
+		total_result &= TestEqual(as.isOk(), true, L"Test: Response file isOk");
+
+		char const* const argv2[] = { "test.exe", "@argstream_test_a.rsp" };
+		std::vector<string> values2;
+		argstream::argstream<char> rec(2, argv2, argstream::RESPONSE_FILE_RECURSIVE);
+		rec >> argstream::parameter('i', "testInt", i, "desc", false)
+			>> argstream::option('o', "testOpt", o, "desc")
+			>> argstream::values<string>(values2, "desc");
+		total_result &= TestEqual(o && values2.size() == 2 && values2[1] == "last", true, L"Test: Recursive response file");
+		total_result &= TestEqual(rec.errors().size() == 1 && rec.errors()[0].code == argstream::ERR_RESPONSE_FILE_CYCLE, true, L"Test: Response file cycle");
+		total_result &= TestEqual(rec.errorLog(), string("Response file argstream_test_a.rsp includes itself\n"), L"Test: Response file cycle message");
+
+		wchar_t const* const argv3[] = { L"test.exe", L"@argstream_test_missing.rsp", L"--", L"@argstream_test_a.rsp" };
+		argstream::argstream<wchar_t> missing(4, argv3, argstream::RESPONSE_FILE_EXPAND);
+		values.clear();
+		missing >> argstream::values<wstring>(values, L"desc");
+		total_result &= TestEqual(missing.errorLog(), wstring(L"Cannot read response file argstream_test_missing.rsp\n"), L"Test: Missing response file");
+		total_result &= TestEqual(values.size() == 1 && values[0] == L"@argstream_test_a.rsp", true, L"Test: Response file after --");
+
+		argstream::counting_resource counter;
+		{
+			argstream::argstream<char> counted(2, argv2, argstream::RESPONSE_FILE_RECURSIVE, &counter);
+			counted >> argstream::parameter('i', "testInt", i, "desc", false);
+		}
+		total_result &= TestEqual(counter.allocations() > 0 && counter.allocations() == counter.deallocations(), true, L"Test: Response files from memory resource");
+		std::remove("argstream_test_a.rsp");
+		std::remove("argstream_test_b.rsp");
+	}
+
+#ifndef WIN32
+	{ //Test environment variables
+		setenv("ARGSTREAM_TEST_THREADS", "8", 1);
+		setenv("ARGSTREAM_TEST_RATE", "fast", 1);
+		setenv("ARGSTREAM_TEST_VERBOSE", "1", 1);
+		setenv("ARGSTREAM_TEST_QUIET", "off", 1);
+		char const* const argv[] = { "test.exe", "--depth", "3" };
+		int threads = 0;
+		int depth = 0;
+		double rate = 0;
+		bool verbose = false;
+		bool quiet = true;
+		argstream::argstream<char> as(3, argv);
+		as >> argstream::parameter('t', "threads", threads, "desc", false, "ARGSTREAM_TEST_THREADS")
+			>> argstream::parameter('d', "depth", depth, "desc", false, "ARGSTREAM_TEST_THREADS")
+			>> argstream::parameter('r', "rate", rate, "desc", false, "ARGSTREAM_TEST_RATE")
+			>> argstream::option('v', "verbose", verbose, "desc", "ARGSTREAM_TEST_VERBOSE")
+			>> argstream::option('q', "quiet", quiet, "desc", "ARGSTREAM_TEST_QUIET");
+		total_result &= TestEqual(threads, 8, L"Test: Environment variable value");
+		total_result &= TestEqual(depth, 3, L"Test: Command line over environment variable");
+		total_result &= TestEqual(verbose && !quiet, true, L"Test: Environment variable options");
+		total_result &= TestEqual(as.errorLog(), string("Invalid value fast of environment variable ARGSTREAM_TEST_RATE\n"), L"Test: Invalid environment variable");
+		total_result &= TestEqual(as.usage().find("desc ($ARGSTREAM_TEST_THREADS)") != string::npos, true, L"Test: Environment variable in usage");
+
+		wchar_t const* const wargv[] = { L"test.exe" };
+		int wthreads = 0;
+		argstream::argstream<wchar_t> was(1, wargv);
+		was >> argstream::parameter(L't', L"threads", wthreads, L"desc", true, L"ARGSTREAM_TEST_THREADS");
+		total_result &= TestEqual(wthreads == 8 && was.isOk(), true, L"Test: Environment variable for wchar_t");
+		unsetenv("ARGSTREAM_TEST_THREADS");
+		unsetenv("ARGSTREAM_TEST_RATE");
+		unsetenv("ARGSTREAM_TEST_VERBOSE");
+		unsetenv("ARGSTREAM_TEST_QUIET");
+	}
+#endif
+
+	{ //Test configuration file
+		{
+			std::ofstream c("argstream_test.conf");
+			c << "# Defaults\n  testInt = 12\ntestDouble=2.5\r\n\n; switch\ntestOpt\nname = two words  \n= 3\n";
+		}
+		wchar_t const* const argv[] = { L"test.exe", L"--testInt", L"34", L"first" };
+		int i = 0;
+		double d = 0;
+		bool o = false;
+		wstring name;
+		std::vector<wstring> values;
+		argstream::argstream<wchar_t> as(4, argv);
+		total_result &= TestEqual(as.config(L"argstream_test.conf"), true, L"Test: Configuration file read");
+		as >> argstream::parameter(L'i', L"testInt", i, L"desc", false)
+			>> argstream::parameter(L'd', L"testDouble", d, L"desc", false)
+			>> argstream::parameter(L'n', L"name", name, L"desc", false)
+			>> argstream::option(L'o', L"testOpt", o, L"desc")
+			>> argstream::values<wstring>(values, L"desc");
+		total_result &= TestEqual(i, 34, L"Test: Command line over configuration file");
+		total_result &= TestEqual(d, 2.5, L"Test: Configuration file value");
+		total_result &= TestEqual(name, wstring(L"two words"), L"Test: Configuration file spaces");
+		total_result &= TestEqual(o, true, L"Test: Configuration file switch");
+		total_result &= TestEqual(values.size() == 1 && values[0] == L"first", true, L"Test: Configuration file values not positional");
+		total_result &= TestEqual(as.errorLog(), wstring(L"Invalid configuration line argstream_test.conf:8: = 3\n"), L"Test: Configuration line without name");
+
+		char const* const argv2[] = { "test.exe" };
+		argstream::argstream<char> missing(1, argv2);
+		total_result &= TestEqual(missing.config("argstream_test_missing.conf"), false, L"Test: Missing configuration file");
+		total_result &= TestEqual(missing.errorLog(), string("Cannot read configuration file argstream_test_missing.conf\n"), L"Test: Missing configuration file message");
+		std::remove("argstream_test.conf");
+	}
+
+	{ //Test configuration file overridden by the command line
+		{
+			std::ofstream c("argstream_test.conf");
+			c << "testInt = 12\no = 1\ntestOpt = off\n";
+		}
+		const char* lines[] = { "test.exe --testInt 34", "test.exe -i 34" };
+		for (const char* line : lines)
+		{
+			int i = 0;
+			bool o = true;
+			bool other = false;
+			argstream::argstream<char> as(line, argstream::SPLIT_POSIX);
+			as.config("argstream_test.conf");
+			as >> argstream::parameter('i', "testInt", i, "desc", false)
+				>> argstream::option('o', "testOpt", o, "desc")
+				>> argstream::OptionHolder<char>("o", other, "desc");
+			total_result &= TestEqual(i == 34 && !o && other, true, L"Test: Configuration file overridden");
+			total_result &= TestEqual(as.defaultErrorHandling(), argstream::RESULT_OF_PARSE::PARSED_OK, L"Test: Configuration file overridden parse result");
+		}
+		char const* const argv[] = { "test.exe" };
+		int i = 0;
+		argstream::argstream<char> late(1, argv);
+		late >> argstream::parameter('i', "testInt", i, "desc", false);
+		total_result &= TestEqual(late.config("argstream_test.conf"), false, L"Test: Configuration file after binding");
+		std::remove("argstream_test.conf");
+	}
+
+	{ //Test several configuration files and unknown settings
+		{
+			std::ofstream c("argstream_test.conf");
+			c << "testInt = 12\ntestDouble = 2.5\notherTool = 3\n";
+			std::ofstream c2("argstream_test2.conf");
+			c2 << "testInt = 34\n";
+		}
+		char const* const argv[] = { "test.exe", "-x" };
+		int i = 0;
+		double d = 0;
+		bool x = false;
+		argstream::argstream<char> as(2, argv);
+		as.config("argstream_test.conf");
+		as.config("argstream_test2.conf");
+		as >> argstream::parameter('i', "testInt", i, "desc", false)
+			>> argstream::parameter('d', "testDouble", d, "desc", false);
+		total_result &= TestEqual(i == 34 && d == 2.5, true, L"Test: Later configuration file overrides");
+		total_result &= TestEqual(as.defaultErrorHandling(), argstream::RESULT_OF_PARSE::PARSED_ERR_UNUSED_PARAMETER, L"Test: Unused argument with configuration file");
+		total_result &= TestEqual(as.unusedPositions() == std::vector<size_t>(1, 1), true, L"Test: Unknown setting not in unused positions");
+		as >> argstream::option('x', "extra", x, "desc");
+		total_result &= TestEqual(as.defaultErrorHandling(), argstream::RESULT_OF_PARSE::PARSED_OK, L"Test: Unknown setting not unused");
+		total_result &= TestEqual(as.reportUnused(), size_t(0), L"Test: Unknown setting not reported");
+		std::remove("argstream_test.conf");
+		std::remove("argstream_test2.conf");
+	}
+
+#ifndef WIN32
+	{ //Test values read from a file descriptor
+		int fds[2];
+		if (pipe(fds) == 0)
+		{
+			const char input[] = "3\0" "long record\0" "x\0" "42";
+			ssize_t written = write(fds[1], input, sizeof(input) - 1);
+			close(fds[1]);
+			char const* const argv[] = { "test.exe", "-0", "1", "2" };
+			bool nul = false;
+			std::vector<string> strings;
+			argstream::NulReader<char> in(fds[0], 4);
+			argstream::argstream<char> as(4, argv);
+			as >> argstream::option('0', "null", nul, "desc")
+				>> argstream::values<string>(in, strings, "desc");
+			close(fds[0]);
+			std::vector<string> expected;
+			expected.push_back("1");
+			expected.push_back("2");
+			expected.push_back("3");
+			expected.push_back("long record");
+			expected.push_back("x");
+			expected.push_back("42");
+			total_result &= TestEqual(written == static_cast<ssize_t>(sizeof(input) - 1) && strings == expected, true, L"Test: Values read from a file descriptor");
+			total_result &= TestEqual(in.count(), static_cast<size_t>(4), L"Test: Records read");
+		}
+		if (pipe(fds) == 0)
+		{
+			// The first record fills the buffer up to its last byte
+			const char input[] = "abc\0" "defgh\0";
+			ssize_t written = write(fds[1], input, sizeof(input) - 1);
+			close(fds[1]);
+			argstream::NulReader<char> in(fds[0], 4);
+			argstream::TSTRVIEW<char> record;
+			bool first = in.next(record) && record == "abc";
+			bool second = in.next(record) && record == "defgh";
+			total_result &= TestEqual(written > 0 && first && second && !in.next(record), true, L"Test: Record ending at the end of the buffer");
+			close(fds[0]);
+		}
+		if (pipe(fds) == 0)
+		{
+			const char input[] = "7\0" "x\0" "8\0";
+			ssize_t written = write(fds[1], input, sizeof(input) - 1);
+			close(fds[1]);
+			wchar_t const* const argv[] = { L"test.exe", L"5" };
+			std::list<int> ints;
+			argstream::NulReader<wchar_t> in(fds[0]);
+			argstream::argstream<wchar_t> as(2, argv);
+			as >> argstream::values<int>(in, std::back_inserter(ints), L"desc", 3);
+			close(fds[0]);
+			total_result &= TestEqual(written > 0 && ints.size() == 2 && ints.back() == 7, true, L"Test: Values read up to the length");
+			total_result &= TestEqual(as.errorLog(), wstring(L"Invalid value x\n"), L"Test: Invalid value read");
+		}
+	}
+#endif
+
+#ifdef __linux__
+	{ //Test arguments of the process
+		const argstream::ProcessArguments<char>& p = argstream::ProcessArguments<char>::instance();
+		const argstream::ProcessArguments<wchar_t>& w = argstream::ProcessArguments<wchar_t>::instance();
+		total_result &= TestEqual(p.argc() >= 1 && p.argv()[p.argc()] == NULL && p.argc() == w.argc(), true, L"Test: Process arguments");
+		total_result &= TestEqual(argstream::TSTR<wchar_t>::ToString(p.argv()[0]), wstring(w.argv()[0]), L"Test: Process arguments decoded");
+		total_result &= TestEqual(&argstream::ProcessArguments<char>::instance() == &p, true, L"Test: Process arguments read once");
+		std::vector<string> rest;
+		argstream::argstream<char> as(p.argc(), p.argv());
+		as >> argstream::values<string>(rest, "desc");
+		total_result &= TestEqual(as.isOk() && rest.size() == static_cast<size_t>(p.argc() - 1), true, L"Test: Process arguments parsed");
+	}
+#endif
+
+	{ //Test schema reused for several command lines
+		wchar_t const* const argv1[] = {
+			L"test.exe",
+			L"--testInt",
+			L"1234",
+			L"-o"
+		};
+		wchar_t const* const argv2[] = {
+			L"test.exe",
+			L"-x"
+		};
+		int testInt = 0;
+		bool testOpt = false;
+		argstream::schema<wchar_t> sc;
+		sc >> argstream::parameter(L's', L"testInt", testInt, L"desc", false)
+		   >> argstream::option(L'o', L"testOpt", testOpt, L"desc");
+		argstream::RESULT_OF_PARSE res = sc.parse(sizeof(argv1)/sizeof(wchar_t*), argv1);
+
+		total_result &= TestEqual(res, argstream::RESULT_OF_PARSE::PARSED_OK, L"Test: Schema parse 1");
+		total_result &= TestEqual(1234, testInt, L"Test: Schema int");
+		total_result &= TestEqual(true, testOpt, L"Test: Schema option");
+
+		res = sc.parse(sizeof(argv2)/sizeof(wchar_t*), argv2);
+		total_result &= TestEqual(res, argstream::RESULT_OF_PARSE::PARSED_ERR_UNUSED_PARAMETER, L"Test: Schema parse 2");
+		total_result &= TestEqual(0, testInt, L"Test: Schema resets int");
+		total_result &= TestEqual(false, testOpt, L"Test: Schema resets option");
+	}
+
+	{ //Test schema of many names
+		std::vector<wstring> names;
+		std::vector<int> ints(300);
+		argstream::schema<wchar_t> sc;
+		for (size_t i = 0; i < ints.size(); ++i)
+		{
+			names.push_back(L"name" + std::to_wstring(i));
+			sc >> argstream::ValueHolder<wchar_t, int>(names.back().c_str(), ints[i], L"desc", false);
+		}
+		// 300 long names: the table is the power of two above 600
+		total_result &= TestEqual(sc.buckets(), static_cast<size_t>(1024), L"Test: Schema hash size");
+		total_result &= TestEqual(sc.find(L"name299"), static_cast<size_t>(299), L"Test: Schema hash lookup");
+		total_result &= TestEqual(sc.find(L"name300"), argstream::schema<wchar_t>::npos, L"Test: Schema hash miss");
+		wchar_t const* const argv[] = { L"test.exe", L"--name150", L"7" };
+		total_result &= TestEqual(sc.parse(3, argv) == argstream::RESULT_OF_PARSE::PARSED_OK && ints[150] == 7, true, L"Test: Schema of many names parse");
+	}
+
+	{ //Test batch of command lines
+		wchar_t const* const lines[] = {
+			L"test.exe -s 12 -o",
+			L"test.exe --testInt 34",
+			L"test.exe -s abc"
+		};
+		int testInt = 5;
+		bool testOpt = false;
+		argstream::schema<wchar_t> sc;
+		sc >> argstream::parameter(L's', L"testInt", testInt, L"desc", false)
+		   >> argstream::option(L'o', L"testOpt", testOpt, L"desc");
+		argstream::batch<wchar_t> b(sc);
+		b.parse(lines, lines + sizeof(lines)/sizeof(wchar_t*));
+		const std::vector<int>& ints = b.column<int>(L"testInt");
+		const std::vector<unsigned char>& opts = b.column<bool>(1);
+
+		total_result &= TestEqual(b.size(), size_t(3), L"Test: Batch size");
+		total_result &= TestEqual(b.result(0), argstream::RESULT_OF_PARSE::PARSED_OK, L"Test: Batch result 1");
+		total_result &= TestEqual(b.result(2), argstream::RESULT_OF_PARSE::PARSED_ERR_OTHER, L"Test: Batch result 3");
+		total_result &= TestEqual(ints[0] == 12 && ints[1] == 34 && ints[2] == 5, true, L"Test: Batch int column");
+		total_result &= TestEqual(opts[0] == 1 && opts[1] == 0 && opts[2] == 0, true, L"Test: Batch option column");
+		total_result &= TestEqual(5, testInt, L"Test: Batch leaves bound variables");
+	}
+
+	{ //Test batch parsed with several threads
+		std::vector<wstring> lines;
+		for (int i = 0; i < 1000; ++i)
+		{
+			wstringstream os;
+			os << L"test.exe -s " << i << (i % 3 ? L" -o" : L" -x");
+			lines.push_back(os.str());
+		}
+		int testInt = -1;
+		bool testOpt = false;
+		argstream::schema<wchar_t> sc;
+		sc >> argstream::parameter(L's', L"testInt", testInt, L"desc", false)
+		   >> argstream::option(L'o', L"testOpt", testOpt, L"desc");
+		argstream::batch<wchar_t> b(sc);
+		b.parse(lines.begin(), lines.end(), 4);
+		const std::vector<int>& ints = b.column<int>(0);
+		const std::vector<unsigned char>& opts = b.column<bool>(1);
+		bool same = (b.size() == lines.size());
+		for (size_t i = 0; same && i < b.size(); ++i)
+		{
+			same = ints[i] == int(i) &&
+				opts[i] == (i % 3 ? 1 : 0) &&
+				b.result(i) == (i % 3 ? argstream::RESULT_OF_PARSE::PARSED_OK : argstream::RESULT_OF_PARSE::PARSED_ERR_UNUSED_PARAMETER);
+		}
+
+		total_result &= TestEqual(same, true, L"Test: Parallel batch");
+	}
+
 	cout << "---------------------" << endl;
 	if (total_result)
 	{